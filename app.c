@@ -21,6 +21,23 @@
 #include "util.h"
 #include "util.c"
 
+#include "thread_pool.h"
+#include "thread_pool.c"
+
+#include "kernels.h"
+#include "kernels.c"
+#include "kernels_dd.c"
+#include "kernels_float.c"
+
+#include "floatexp.h"
+#include "floatexp.c"
+
+#include "hp.h"
+#include "hp.c"
+
+#include "perturb.h"
+#include "perturb.c"
+
 #ifdef USE_CUDA
 #include "mandelbrot_gpu.h"
 #endif
@@ -28,6 +45,37 @@
 simple_font_t* simple_font = NULL;
 color_t color_map[512];
 
+/*
+    Counters for the last rendered frame
+ */
+typedef struct
+{
+    u64 pixels;
+    escape_stats_t escape;
+    u32 tiles[PRECISION_COUNT];     // how many tiles ran at each precision
+    u64 filled;                     // pixels filled by subdivision without iterating
+    u32 pieces;                     // tiles split off while other workers were idle
+    u64 reused;                     // pixels taken over from the last frame after a pan
+    u64 mirrored;                   // pixels copied from their conjugates across the real axis
+    u64 antialiased;                // edge pixels with extra samples
+    u64 aa_samples;                 // extra samples taken for them this frame
+    u64 accumulated;                // pixels that took another sample this frame (temporal accumulation)
+    u32 accum_round;
+
+    int workers;
+    pool_worker_stats_t worker[POOL_MAX_THREADS];
+} render_stats_t;
+
+render_stats_t g_render_stats = {0};
+
+// profiler entries for the tiles of each precision, summed over the worker threads
+const char *g_tile_profile_labels[PRECISION_COUNT] = {
+    "tiles float32", "tiles double", "tiles double-double", "tiles perturbation", "tiles extended", "tiles direct hp"
+};
+
+ref_orbit_t g_ref_orbit = {0};
+bla_table_t g_bla_table = {0};
+
 #define SCREEN_TO_COMPLEX(screen, center, screen_size, scale) \
     ((center) + ((screen) - (screen_size) / 2.0) * (scale))
 
@@ -40,6 +88,14 @@ color_t color_map[512];
 #define REANCHOR_VIEW(fixed_world_coord, screen_coord, screen_size, new_scale)\
    ((fixed_world_coord) - ((screen_coord) - (screen_size)/2.0) * (new_scale))
 
+// range for the iteration cap keys, the reference orbit keeps one double pair per iteration
+#define MIN_ITERATIONS_LIMIT 64
+#define MAX_ITERATIONS_LIMIT (1 << 21)
+
+// palette keys, how far the density goes either way and seconds per cycle
+#define PALETTE_DENSITY_LIMIT 1024.0f
+#define PALETTE_CYCLE_TIME 10.0f
+
 
 typedef enum {
     COLOR_GRAYSCALE,
@@ -48,25 +104,25 @@ typedef enum {
     COLOR_BLUE,
     COLOR_NEON,
     COLOR_ULTRA,
-    COLOR_SPECTRAL
+    COLOR_SPECTRAL,
+    COLOR_PALETTE_COUNT
 }color_palette_t;
 
-color_t get_color(int iterations, int max_iterations, color_palette_t palette) 
-{
-    if (iterations == max_iterations) {
-        return make_color(0, 0, 0);  
-    }
+const char *g_palette_names[COLOR_PALETTE_COUNT] = { "grayscale", "rainbow 1", "rainbow 2", "blue", "neon", "ultra", "spectral" };
 
+// iterations is a smooth count in [0, max_iterations], the points inside are up to the caller
+color_t get_color(float iterations, int max_iterations, color_palette_t palette) 
+{
     switch(palette)
     {
         case COLOR_GRAYSCALE:
         {
-            uint8_t brightness = (iterations * 255) / max_iterations;
+            uint8_t brightness = (uint8_t)(iterations * 255.0f / max_iterations);
             return make_color(brightness, brightness, brightness);
         }
         case COLOR_RAINBOW_1:
         {
-            int hue = (iterations * 16) % 256;
+            int hue = (int)(iterations * 16.0f) % 256;
             if (hue < 64) {
                 return make_color(255, hue * 4, 0);   
             } else if (hue < 128) {
@@ -79,7 +135,7 @@ color_t get_color(int iterations, int max_iterations, color_palette_t palette)
         }
         case COLOR_RAINBOW_2:
         {
-            float hue = (float)iterations / (float)max_iterations * 360.0f;
+            float hue = iterations / (float)max_iterations * 360.0f;
             float h = hue / 60.0f;
             int i = (int)h;
             float f = h - i;
@@ -99,9 +155,7 @@ color_t get_color(int iterations, int max_iterations, color_palette_t palette)
         }
         case COLOR_BLUE:
         {
-            // Continuous Dwell
-            float smooth_iter = (float)iterations - log2f(log2f(sqrtf(iterations * iterations))) + 4.0f;
-            float t = smooth_iter / (float)max_iterations;
+            float t = iterations / (float)max_iterations;
             
             uint8_t r = (uint8_t)(9 * (1-t) * t * t * t * 255);
             uint8_t g = (uint8_t)(15 * (1-t) * (1-t) * t * t * 255);
@@ -111,7 +165,7 @@ color_t get_color(int iterations, int max_iterations, color_palette_t palette)
         }
         case COLOR_NEON:
         {
-            float t = (float)iterations / (float)max_iterations;
+            float t = iterations / (float)max_iterations;
             
             uint8_t r = (uint8_t)(sinf(t * 6.28f + 0.0f) * 127 + 128);
             uint8_t g = (uint8_t)(sinf(t * 6.28f + 2.09f) * 127 + 128);
@@ -121,7 +175,7 @@ color_t get_color(int iterations, int max_iterations, color_palette_t palette)
         }
         case COLOR_ULTRA:
         {
-            float t = (float)iterations / (float)max_iterations;
+            float t = iterations / (float)max_iterations;
             
             if (t < 0.16f) {
                 uint8_t val = (uint8_t)(t * 255 * 6.25f);
@@ -145,7 +199,245 @@ color_t get_color(int iterations, int max_iterations, color_palette_t palette)
         }
         case COLOR_SPECTRAL:
         {
-            return color_map[iterations % 512];
+            return color_map[(int)iterations % 512];
+        }
+        default:
+        {
+            return make_color(0, 0, 0);
+        }
+    }
+}
+
+/*
+    get_color() is a switch with sines and branches per call, too much for every pixel of
+    every recolouring. The palette is baked into a table once and the pixels just index it,
+    the table only changes with the palette: most palettes spread over max_iterations and
+    are sampled by their fraction of it, the other two repeat every so many iterations and
+    are stored one cycle at the resolution they actually have.
+ */
+#define PALETTE_LUT_SIZE 4096
+
+typedef struct
+{
+    bool built;
+    color_palette_t palette;
+    u32 size;               // a power of two, at most PALETTE_LUT_SIZE
+    float cycle;            // iterations the table covers, 0 for max_iterations
+    color_t entries[PALETTE_LUT_SIZE];
+} palette_lut_t;
+
+palette_lut_t g_palette_lut = {0};
+
+void palette_lut_build(palette_lut_t *lut, color_palette_t palette)
+{
+    switch (palette)
+    {
+        case COLOR_RAINBOW_1: lut->size = 256; lut->cycle = 16.0f;  break;   // a hue step every 1/16th
+        case COLOR_SPECTRAL:  lut->size = 512; lut->cycle = 512.0f; break;   // color_map
+        default:              lut->size = PALETTE_LUT_SIZE; lut->cycle = 0.0f; break;
+    }
+
+    for (u32 i = 0; i < lut->size; ++i) {
+        float iterations = lut->cycle > 0.0f ? (float)i * lut->cycle / (float)lut->size : (float)i;
+        lut->entries[i] = get_color(iterations, (int)lut->size, palette);
+    }
+
+    lut->palette = palette;
+    lut->built = true;
+}
+
+/*
+    Continuous iteration count, n + 1 - log2(log2 |z_n|): |z| squares every iteration
+    once it is past the escape radius of 2, so this goes up by one from one band to
+    the next and smoothly in between, instead of a step at every count.
+    SMOOTH_INSIDE for the points that never escaped, SMOOTH_UNKNOWN where nothing is known.
+ */
+#define SMOOTH_INSIDE   INFINITY
+#define SMOOTH_UNKNOWN  (-1.0f)
+
+static inline float smooth_iterations(int iterations, float magnitude, int max_iterations)
+{
+    if (iterations >= max_iterations)
+        return SMOOTH_INSIDE;
+
+    // |z|^2 is just past 4 for the ones that barely escaped, a float may have it at 4
+    return (float)iterations + 1.0f - log2f(0.5f * log2f(MAX(magnitude, 4.0f)));
+}
+
+/*
+    How smooth counts become colours. The frame keeps the counts (see frame_cache_t),
+    so any change here is a recolouring pass over them and nothing is iterated again.
+ */
+typedef struct
+{
+    color_palette_t palette;
+    int max_iterations;
+    float density;          // times the palette repeats over max_iterations
+    float offset;           // fraction of the palette it is shifted by, what cycling animates
+
+    // g_palette_lut, a position in [0, max_iterations) is entry (int)(position * lut_scale) & lut_mask
+    const color_t *lut;
+    u32 lut_mask;
+    float lut_scale;
+
+    /*
+        Histogram equalization, the smooth counts go through the frame's cumulative
+        distribution first (equalize_finish), so every part of the palette covers about
+        as many pixels whatever the spread of the counts. equalize_cdf has
+        max_iterations + 1 entries, count n maps to [equalize_cdf[n], equalize_cdf[n + 1]],
+        NULL until there is one for this max_iterations.
+     */
+    bool equalize;
+    const float *equalize_cdf;
+} coloring_t;
+
+/* Rebuilds g_palette_lut first if it holds another palette */
+coloring_t make_coloring(color_palette_t palette, int max_iterations, float density, float offset)
+{
+    palette_lut_t *lut = &g_palette_lut;
+    if (!lut->built || lut->palette != palette) {
+        palette_lut_build(lut, palette);
+    }
+
+    coloring_t coloring = {
+        .palette = palette,
+        .max_iterations = max_iterations,
+        .density = density,
+        .offset = offset,
+        .lut = lut->entries,
+        .lut_mask = lut->size - 1,
+        .lut_scale = (float)lut->size / (lut->cycle > 0.0f ? lut->cycle : (float)max_iterations)
+    };
+    return coloring;
+}
+
+static inline float equalize_smooth(const coloring_t *coloring, float smooth)
+{
+    const float *cdf = coloring->equalize_cdf;
+    int n = (int)floorf(smooth);
+    n = MAX(0, MIN(coloring->max_iterations - 1, n));
+
+    float f = smooth - (float)n;
+    f = MAX(0.0f, MIN(1.0f, f));
+    return cdf[n] + f * (cdf[n + 1] - cdf[n]);
+}
+
+static inline color_t coloring_apply(const coloring_t *coloring, float smooth)
+{
+    if (smooth == SMOOTH_INSIDE) {
+        return make_color(0, 0, 0);
+    }
+
+    if (coloring->equalize_cdf) {
+        smooth = equalize_smooth(coloring, smooth);
+    }
+
+    float period = (float)coloring->max_iterations;
+    float position = smooth * coloring->density + coloring->offset * period;
+    position -= period * floorf(position / period);
+    return coloring->lut[(u32)(position * coloring->lut_scale) & coloring->lut_mask];
+}
+
+#if KERNELS_X86
+/*
+    coloring_apply() on a row, 8 pixels at a time with the table lookups as one gather.
+    The points inside come out of the wrap as nan, whatever entry that picks is replaced
+    by black, and SMOOTH_UNKNOWN is not stored at all.
+ */
+KERNEL_TARGET("avx2")
+void colorize_row_avx2(const coloring_t *coloring, const float *smooth, color_t *pixels, u32 count)
+{
+    const __m256 period = _mm256_set1_ps((float)coloring->max_iterations);
+    const __m256 density = _mm256_set1_ps(coloring->density);
+    const __m256 shift = _mm256_set1_ps(coloring->offset * (float)coloring->max_iterations);
+    const __m256 scale = _mm256_set1_ps(coloring->lut_scale);
+    const __m256i mask = _mm256_set1_epi32((int)coloring->lut_mask);
+    const __m256 inside = _mm256_set1_ps(SMOOTH_INSIDE);
+    const __m256 zero = _mm256_setzero_ps();
+
+    color_t black_color = make_color(0, 0, 0);
+    int black_bits;
+    memcpy(&black_bits, &black_color, sizeof(black_bits));
+    const __m256i black = _mm256_set1_epi32(black_bits);
+
+    const __m256i last_count = _mm256_set1_epi32(coloring->max_iterations - 1);
+    const __m256 one = _mm256_set1_ps(1.0f);
+
+    u32 x = 0;
+    for (; x + 8 <= count; x += 8)
+    {
+        __m256 value = _mm256_loadu_ps(smooth + x);
+        __m256 remapped = value;
+
+        if (coloring->equalize_cdf)
+        {
+            __m256i n = _mm256_cvttps_epi32(_mm256_floor_ps(value));
+            n = _mm256_max_epi32(_mm256_setzero_si256(), _mm256_min_epi32(last_count, n));
+
+            __m256 f = _mm256_sub_ps(value, _mm256_cvtepi32_ps(n));
+            f = _mm256_max_ps(zero, _mm256_min_ps(one, f));
+
+            __m256 low = _mm256_i32gather_ps(coloring->equalize_cdf, n, 4);
+            __m256 high = _mm256_i32gather_ps(coloring->equalize_cdf + 1, n, 4);
+            remapped = _mm256_add_ps(low, _mm256_mul_ps(f, _mm256_sub_ps(high, low)));
+        }
+
+        // same operations as coloring_apply(), no fma and a real division, so both pick the same entry
+        __m256 position = _mm256_add_ps(_mm256_mul_ps(remapped, density), shift);
+        position = _mm256_sub_ps(position, _mm256_mul_ps(period, _mm256_floor_ps(_mm256_div_ps(position, period))));
+
+        __m256i index = _mm256_and_si256(_mm256_cvttps_epi32(_mm256_mul_ps(position, scale)), mask);
+        __m256i color = _mm256_i32gather_epi32((const int *)coloring->lut, index, 4);
+        color = _mm256_blendv_epi8(color, black, _mm256_castps_si256(_mm256_cmp_ps(value, inside, _CMP_EQ_OQ)));
+
+        __m256i known = _mm256_castps_si256(_mm256_cmp_ps(value, zero, _CMP_GE_OQ));
+        _mm256_maskstore_epi32((int *)(pixels + x), known, color);
+    }
+
+    for (; x < count; ++x) {
+        if (smooth[x] >= 0.0f) {
+            pixels[x] = coloring_apply(coloring, smooth[x]);
+        }
+    }
+}
+#endif
+
+/*
+    Colours every step-th pixel of every step-th row in [start_x, end_x) x [start_y, end_y)
+    from the smooth counts of the whole screen, with fill_blocks the pixels up to the next
+    one get the same colour. SMOOTH_UNKNOWN is left as the background.
+ */
+void colorize_rect(platform_api_t *platform, const float *smooth, const coloring_t *coloring,
+                   u32 start_x, u32 end_x, u32 start_y, u32 end_y, u32 step, bool fill_blocks)
+{
+    u32 width = platform->screen_width;
+    u32 block = fill_blocks ? step : 1;
+
+    #if KERNELS_X86
+        // every pixel, the rows are contiguous in both buffers
+        if (step == 1 && g_kernels.isa >= KERNEL_AVX2)
+        {
+            for (u32 y = start_y; y < end_y; ++y) {
+                colorize_row_avx2(coloring, smooth + y * width + start_x, platform->pixels + y * width + start_x, end_x - start_x);
+            }
+            return;
+        }
+    #endif
+
+    for (u32 y = CEIL_DIV(start_y, step) * step; y < end_y; y += step)
+    {
+        for (u32 x = CEIL_DIV(start_x, step) * step; x < end_x; x += step)
+        {
+            float value = smooth[y * width + x];
+            if (value < 0.0f)
+                continue;
+
+            color_t color = coloring_apply(coloring, value);
+            for (u32 by = y; by < MIN(end_y, y + block); ++by) {
+                for (u32 bx = x; bx < MIN(end_x, x + block); ++bx) {
+                    platform->pixels[by * width + bx] = color;
+                }
+            }
         }
     }
 }
@@ -187,57 +479,39 @@ color_t get_color(int iterations, int max_iterations, color_palette_t palette)
         with z=0 and applying the iteration repeatedly the absolute value of z
         stays bounded for all numbers
 */
-void render_mandelbrot_simple(platform_api_t *platform, double center_x, double center_y, double scale, int max_iterations) 
+void render_mandelbrot_simple(platform_api_t *platform, const coloring_t *coloring, double center_x, double center_y, double scale, int max_iterations) 
 {
-    const double limit = 4.0;  // (we cannot get past the escape radius = 2.0 so no need to calculate further (squared so we dont deal with sqrt))
-    
     int width = platform->screen_width;
     int height = platform->screen_height;
+
+    escape_params_t params = { 
+        .max_iterations = max_iterations,
+        .cycle_tolerance = scale * CYCLE_TOLERANCE_SCALE
+    };
+    escape_stats_t stats = {0};
+
+    double c_re[ESCAPE_BATCH];
+    double c_im[ESCAPE_BATCH];
+    int iterations[ESCAPE_BATCH];
+    float magnitudes[ESCAPE_BATCH];
     
     for (int py = 0; py < height; py++) 
     {
-        for (int px = 0; px < width; px++) 
+        for (int px = 0; px < width; px += ESCAPE_BATCH) 
         {
-            
-            double c_re = SCREEN_TO_COMPLEX(px,center_x,width,scale);
-            double c_im = SCREEN_TO_COMPLEX(py,center_y,height,scale);
-            
-            double z_re = 0.0;
-            double z_im = 0.0;
+            int count = MIN(ESCAPE_BATCH, width - px);
 
-            int iteration = 0;
-
-            /*
-                Remember :
-                - i^2 = -1
+            for (int i = 0; i < count; i++) {
+                c_re[i] = SCREEN_TO_COMPLEX(px + i,center_x,width,scale);
+                c_im[i] = SCREEN_TO_COMPLEX(py,center_y,height,scale);
+            }
 
-                - (z_re + z_img i)^2 = z_re^2 - z_im^2 + {(2 * z_re * z_img) i}
+            escape_time(&params, c_re, c_im, count, iterations, magnitudes, &stats);
 
-                - z^2 + c = (z_re^2 - z_im^2 + c_re) + (2 * z_re * z_img + c_im) i 
-             */
-            while (iteration < max_iterations) 
-            {
-                double re_tmp = z_re*z_re - z_im*z_im + c_re;
-                z_im = 2 * z_re * z_im + c_im;
-                z_re = re_tmp;
-                iteration++;
-
-                // distance larger than escape radius abort
-                if (z_re*z_re + z_im*z_im > limit) 
-                    break;
-                
-                // unrolled will it do anything ? please auto vectorize
-                re_tmp = z_re*z_re - z_im*z_im + c_re;
-                z_im = 2*z_re*z_im + c_im;
-                z_re = re_tmp;
-                iteration++;
-
-                if (z_re*z_re + z_im*z_im > limit) 
-                    break;
+            for (int i = 0; i < count; i++) {
+                color_t color = coloring_apply(coloring, smooth_iterations(iterations[i], magnitudes[i], max_iterations));
+                set_pixel(platform, px + i, py, color);
             }
-            
-            color_t color = get_color(iteration, max_iterations, COLOR_BLUE);
-            set_pixel(platform, px, py, color);
         }
     }
 }
@@ -246,46 +520,47 @@ void render_mandelbrot_simple(platform_api_t *platform, double center_x, double
     In the julia set the parameter "c" is fixed, and the initial object varies across the complex plane
  */
 
-void render_julia_set(platform_api_t *platform, double cx, double cy, int x, int y, int width, int height, int max_iterations) 
+void render_julia_set(platform_api_t *platform, const coloring_t *coloring, double cx, double cy, int x, int y, int width, int height, int max_iterations) 
 {
-    const double limit = 4.0;
-    
-    double c_re = cx;
-    double c_im = cy;
-    
     double scale = 4.0 / width;
+
+    // the palette of the main view, spread over this one's iterations
+    coloring_t julia_coloring = make_coloring(coloring->palette, max_iterations, coloring->density, coloring->offset);
+
+    escape_params_t params = {
+        .max_iterations = max_iterations,
+        .julia = true,
+        .julia_re = cx,
+        .julia_im = cy,
+        .cycle_tolerance = scale * CYCLE_TOLERANCE_SCALE
+    };
+    escape_stats_t stats = {0};
+
+    double z_re[ESCAPE_BATCH];
+    double z_im[ESCAPE_BATCH];
+    int iterations[ESCAPE_BATCH];
+    float magnitudes[ESCAPE_BATCH];
     
     for (int py = y; py < y + height; py++) 
     {
-        for (int px = x; px < x + width; px++) 
+        for (int px = x; px < x + width; px += ESCAPE_BATCH) 
         {
+            int count = MIN(ESCAPE_BATCH, x + width - px);
+
             /* 
                 initial object varies and c is const
              */
-            double z_re = LOCAL_TO_COMPLEX(px, x, width, scale);
-            double z_im = LOCAL_TO_COMPLEX(py, y, height, scale);
-            
-            int iteration = 0;
-            
-            while (iteration < max_iterations) 
-            {
-                double z_re_temp = z_re*z_re - z_im*z_im + c_re;
-                z_im = 2*z_re*z_im + c_im;
-                z_re = z_re_temp;
-                iteration++;
-                if (z_re*z_re + z_im*z_im > limit) 
-                    break;
-                
-                z_re_temp = z_re*z_re - z_im*z_im + c_re;
-                z_im = 2*z_re*z_im + c_im;
-                z_re = z_re_temp;
-                iteration++;
-                if (z_re*z_re + z_im*z_im > limit) 
-                    break;
+            for (int i = 0; i < count; i++) {
+                z_re[i] = LOCAL_TO_COMPLEX(px + i, x, width, scale);
+                z_im[i] = LOCAL_TO_COMPLEX(py, y, height, scale);
+            }
+
+            escape_time(&params, z_re, z_im, count, iterations, magnitudes, &stats);
+
+            for (int i = 0; i < count; i++) {
+                float smooth = smooth_iterations(iterations[i], magnitudes[i], max_iterations);
+                set_pixel(platform, px + i, py, coloring_apply(&julia_coloring, smooth));
             }
-            
-            color_t color = get_color(iteration, max_iterations,COLOR_BLUE);
-            set_pixel(platform, px, py, color);
         }
     }
     
@@ -432,7 +707,72 @@ void render_complex_plane(platform_api_t *platform, double m_cx, double m_cy, do
     }
 }
 
-typedef struct 
+/*
+    How the tiles of a frame get iterated past what a double can do, without a reference
+    or limbs every tile picks float / double / double-double for itself.
+ */
+typedef struct
+{
+    // perturbation around a reference orbit
+    const ref_orbit_t *ref;
+    const bla_table_t *bla;     // optional, NULL iterates every step
+    double ref_offset_x;        // view centre - reference point
+    double ref_offset_y;
+
+    // past EXTENDED_SCALE, the spacing and the reference offset with their own exponent
+    bool extended;
+    fe_t scale_fe;
+    fe_t ref_offset_fe_x;
+    fe_t ref_offset_fe_y;
+
+    // the part of the exact view centre center_x/y lost, for the double-double kernels
+    double center_lo_x;
+    double center_lo_y;
+
+    // direct iteration at full precision around the exact view centre
+    const hp_t *center_hp_x;
+    const hp_t *center_hp_y;
+    int limbs;
+} deep_params_t;
+
+/*
+    Tiles split on demand: a worker that picks up a tile while others sit idle with
+    nothing to steal keeps a quarter and submits the other three (64 -> 32 -> 16),
+    and a row rendered tile still going when someone runs dry hands off the bottom
+    half of its remaining rows. The pieces land on the worker's deque for the idle
+    ones to steal, so the frame doesn't wait on whoever drew the slowest tile.
+
+    Pieces come out of the frame's tile array past the real tiles, once that runs
+    out tiles just stay whole.
+ */
+#define TILE_SPLIT_MIN_SIZE 16
+#define TILE_PIECES_PER_TILE 4
+
+typedef struct tile_data_t tile_data_t;
+typedef struct equalize_t equalize_t;
+
+typedef struct
+{
+    tile_data_t *tiles;
+    u32 capacity;
+    atomic_i64_t used;
+} tile_pieces_t;
+
+/*
+    What goes on screen while a preview frame is still being rendered. The workers keep
+    writing into the frame, so it can't be shown as is: every tile copies its rect over
+    here once it is coloured, and the copy is presented, both under the lock.
+ */
+typedef struct
+{
+    mutex_t lock;
+    color_t *pixels;
+    u32 width, height;
+} preview_screen_t;
+
+preview_screen_t g_preview_screen = {0};
+
+struct tile_data_t
 {
     u32 start_x, end_x;
     u32 start_y, end_y;
@@ -442,209 +782,2435 @@ typedef struct
     double center_x;
     double center_y;
     double scale;
-} tile_data_t;
 
-thread_func_ret_t render_tile(thread_func_param_t data) 
+    deep_params_t deep;
+    precision_t precision;
+    bool subdivide;
+
+    // progressive levels, see render_mandelbrot_parallel
+    u32 step;                   // only every step-th pixel on both axes
+    u32 done_step;              // the samples on this grid came from an earlier level, 0 for none
+    bool fill_blocks;           // a sample covers the pixels up to the next one until a finer level gets there
+    u8 *guessed;                // per screen pixel, set for samples taken from their neighbours, NULL never guesses
+    preview_screen_t *shown;    // the finished tiles of a preview frame go here, NULL when there is none
+    equalize_t *histogram;      // counts the finished pixels for equalization, NULL when not needed
+
+    tile_pieces_t *pieces;
+    u32 index;                  // the frame tile, pieces keep their parent's
+    int *counts;                // iteration counts of the whole screen, kept in the frame cache
+    float *smooth;              // and the smooth counts the pixels are coloured from
+    const coloring_t *coloring;
+    int64_t generation;         // g_view_generation when the frame started
+    bool abandoned;
+
+    escape_stats_t stats;
+    u64 filled;                 // pixels the subdivision filled without iterating
+    double elapsed_ms;
+};
+
+/*
+    Bumped by app_update whenever the view or the iteration cap changes. A frame
+    remembers the value it started with and its tiles give up between rows once it
+    moved on, a stale frame is not worth finishing with a new one on the way.
+
+    app_render runs on its own thread, a copy of the state it was handed is what gets
+    drawn so the frame goes by the generation in that copy (g_frame_generation), the
+    live one may already be ahead of it.
+ */
+atomic_i64_t g_view_generation = 0;
+int64_t g_frame_generation = 0;
+
+static bool tile_stale(tile_data_t *tile)
 {
-    tile_data_t *tile = (tile_data_t *)data;
+    if (atomic_load_i64(&g_view_generation) != tile->generation) {
+        tile->abandoned = true;
+    }
+    return tile->abandoned;
+}
 
-    const double limit = 4.0;      // (we cannot get past the escape radius so no need to calculate further (distance sqrt no need))
-    
-    for (u32 y = tile->start_y; y < tile->end_y; ++y) 
+/*
+    Escape times of "count" (up to ESCAPE_BATCH) pixels of the tile at px[i], py[i],
+    with whatever number type the tile was given, and their smooth counts.
+    offset_x/y move the points inside their pixels (anti-aliasing), NULL for the pixels themselves.
+ */
+void tile_escape_time(tile_data_t *tile, const u32 *px, const u32 *py, const float *offset_x, const float *offset_y,
+                      int count, int *iterations, float *smooth)
+{
+    const deep_params_t *deep = &tile->deep;
+
+    double sx[ESCAPE_BATCH];
+    double sy[ESCAPE_BATCH];
+    for (int i = 0; i < count; ++i) {
+        sx[i] = px[i] + (offset_x ? offset_x[i] : 0.0);
+        sy[i] = py[i] + (offset_y ? offset_y[i] : 0.0);
+    }
+
+    escape_params_t params = {
+        .max_iterations = tile->max_iterations,
+        .cycle_tolerance = tile->scale * CYCLE_TOLERANCE_SCALE
+    };
+
+    double c_re[ESCAPE_BATCH];
+    double c_im[ESCAPE_BATCH];
+    double c_re_lo[ESCAPE_BATCH];
+    double c_im_lo[ESCAPE_BATCH];
+    float c_re_f[ESCAPE_BATCH];
+    float c_im_f[ESCAPE_BATCH];
+    fe_t c_re_fe[ESCAPE_BATCH];
+    fe_t c_im_fe[ESCAPE_BATCH];
+    float magnitudes[ESCAPE_BATCH];
+
+    switch (tile->precision)
     {
-        for (u32 x = tile->start_x; x < tile->end_x; ++x) 
+        case PRECISION_FLOAT:
         {
-            double c_re = SCREEN_TO_COMPLEX(x, tile->center_x, tile->platform->screen_width, tile->scale);
-            double c_im = SCREEN_TO_COMPLEX(y, tile->center_y, tile->platform->screen_height, tile->scale);
-            
-            double z_re = 0.0;
-            double z_im = 0.0;
+            for (int i = 0; i < count; ++i) {
+                c_re_f[i] = (float)SCREEN_TO_COMPLEX(sx[i], tile->center_x, tile->platform->screen_width, tile->scale);
+                c_im_f[i] = (float)SCREEN_TO_COMPLEX(sy[i], tile->center_y, tile->platform->screen_height, tile->scale);
+            }
 
-            int iteration = 0;
+            escape_time_float(&params, c_re_f, c_im_f, count, iterations, magnitudes, &tile->stats);
+        } break;
 
-            while (iteration < tile->max_iterations) 
-            {
-                double re_tmp = z_re*z_re - z_im*z_im + c_re;
-                z_im = 2 * z_re * z_im + c_im;
-                z_re = re_tmp;
-                iteration++;
-
-                if (z_re*z_re + z_im*z_im > limit) 
-                    break;
-                
-                re_tmp = z_re*z_re - z_im*z_im + c_re;
-                z_im = 2*z_re*z_im + c_im;
-                z_re = re_tmp;
-                iteration++;
-
-                if (z_re*z_re + z_im*z_im > limit) 
-                    break;
+        case PRECISION_DOUBLE:
+        {
+            for (int i = 0; i < count; ++i) {
+                c_re[i] = SCREEN_TO_COMPLEX(sx[i], tile->center_x, tile->platform->screen_width, tile->scale);
+                c_im[i] = SCREEN_TO_COMPLEX(sy[i], tile->center_y, tile->platform->screen_height, tile->scale);
             }
-            
-            color_t color = get_color(iteration, tile->max_iterations, COLOR_BLUE);
-            set_pixel(tile->platform, x, y, color);
 
-/*             if(y == tile->start_y ||  y == tile->end_y-1)
-                set_pixel_blend(tile->platform, x, y, (color_t){255,255,255,64});
+            escape_time(&params, c_re, c_im, count, iterations, magnitudes, &tile->stats);
+        } break;
 
-            if(x == tile->start_x ||  x == tile->end_x-1)
-                set_pixel_blend(tile->platform, x, y, (color_t){255,255,255,64}); */
+        case PRECISION_DOUBLE_DOUBLE:
+        {
+            double offset_re[ESCAPE_BATCH];
+            double offset_im[ESCAPE_BATCH];
 
-        }
-    }
+            for (int i = 0; i < count; ++i) {
+                offset_re[i] = SCREEN_TO_COMPLEX(sx[i], 0.0, tile->platform->screen_width, tile->scale);
+                offset_im[i] = SCREEN_TO_COMPLEX(sy[i], 0.0, tile->platform->screen_height, tile->scale);
+            }
 
-    #ifdef _WIN32
-        return 0;
-    #else
-        return NULL;
-    #endif
-}
+            dd_offset_points(tile->center_x, deep->center_lo_x, offset_re, count, c_re, c_re_lo);
+            dd_offset_points(tile->center_y, deep->center_lo_y, offset_im, count, c_im, c_im_lo);
 
-void render_mandelbrot_parallel(platform_api_t *platform, double center_x, double center_y, double scale, int max_iterations)
-{
-    u32 height  = platform->screen_height;
-    u32 width   = platform->screen_width;
+            escape_time_dd(&params, c_re, c_re_lo, c_im, c_im_lo, count, iterations, magnitudes, &tile->stats);
+        } break;
 
-    i32 num_threads = get_core_count();
+        case PRECISION_PERTURBATION:
+        {
+            // offsets from the reference point instead of absolute coordinates
+            for (int i = 0; i < count; ++i) {
+                c_re[i] = SCREEN_TO_COMPLEX(sx[i], deep->ref_offset_x, tile->platform->screen_width, tile->scale);
+                c_im[i] = SCREEN_TO_COMPLEX(sy[i], deep->ref_offset_y, tile->platform->screen_height, tile->scale);
+            }
 
-    // slice the screen up to 64x64 px tiles
-    const u32 tile_size = 64;
+            perturb_escape_time(deep->ref, deep->bla, c_re, c_im, count, iterations, magnitudes, &tile->stats);
+        } break;
 
-    u32 tiles_x = CEIL_DIV(width, tile_size);
-    u32 tiles_y = CEIL_DIV(height, tile_size);
-    u32 total_tiles = tiles_x * tiles_y;
+        case PRECISION_EXTENDED:
+        {
+            for (int i = 0; i < count; ++i) {
+                fe_t offset_re = fe_mul_double(deep->scale_fe, sx[i] - tile->platform->screen_width / 2.0);
+                fe_t offset_im = fe_mul_double(deep->scale_fe, sy[i] - tile->platform->screen_height / 2.0);
+                c_re_fe[i] = fe_add(deep->ref_offset_fe_x, offset_re);
+                c_im_fe[i] = fe_add(deep->ref_offset_fe_y, offset_im);
+            }
 
-    tile_data_t* tiles = malloc(total_tiles * sizeof(tile_data_t));
-    thread_handle_t* threads = malloc(num_threads * sizeof(thread_handle_t));
+            perturb_escape_time_fe(deep->ref, deep->bla, c_re_fe, c_im_fe, count, iterations, magnitudes, &tile->stats);
+        } break;
 
-    i32 tile_idx = 0;
-    
-    for (u32 ty = 0; ty < tiles_y; ty++) 
-    {
-        u32 start_y = ty * tile_size;
-        u32 end_y = MIN(height, start_y + tile_size);
-        
-        for (u32 tx = 0; tx < tiles_x; tx++) 
+        default:
         {
-            u32 start_x = tx * tile_size;
-            u32 end_x = MIN(width, (start_x + tile_size)); 
-            
-            tiles[tile_idx] = (tile_data_t){
-                .start_x = start_x, .end_x = end_x,
-                .start_y = start_y, .end_y = end_y,
-                .width = width, .height = height,
-                .platform = platform,
-                .max_iterations = max_iterations,
-                .center_x = center_x,
-                .center_y = center_y,
-                .scale  = scale
-            };
-            
-            int thread_slot = tile_idx % num_threads;
-            
-            if (tile_idx >= num_threads) {
-                PROFILE("Waiting for a slot"){
-                    join_thread(threads[thread_slot]);
-                }
-            }
-            
-            PROFILE("Actually creating a thread, does it matter ?")
-            {
-                threads[thread_slot] = create_thread(render_tile, &tiles[tile_idx]);
+            // offsets from the view centre, added to it at full precision
+            for (int i = 0; i < count; ++i) {
+                c_re_fe[i] = fe_mul_double(deep->scale_fe, sx[i] - tile->platform->screen_width / 2.0);
+                c_im_fe[i] = fe_mul_double(deep->scale_fe, sy[i] - tile->platform->screen_height / 2.0);
             }
-            
-            tile_idx++;
-        }
-    }
-
-    // total num of tiles maybe less than number of threads created 
-    int remaining_threads = MIN(total_tiles, num_threads);
 
-    PROFILE("Waiting to join")
-    {
-        for (int i = 0; i < remaining_threads; i++) {
-            join_thread(threads[i]);
-        }
+            direct_escape_time(deep->center_hp_x, deep->center_hp_y, deep->limbs, tile->max_iterations,
+                               c_re_fe, c_im_fe, count, iterations, magnitudes);
+        } break;
     }
 
-    free(tiles);
-    free(threads);
+    for (int i = 0; i < count; ++i) {
+        smooth[i] = smooth_iterations(iterations[i], magnitudes[i], tile->max_iterations);
+    }
 }
 
-void render_mandelbrot_gpu(platform_api_t *platform, double center_x, double center_y, 
-                           double scale, int max_iterations) 
+/*
+    Mariani-Silver subdivision: the set and the bands of equal iteration count are
+    connected, so a rectangle whose whole border has one count has it inside too.
+    Only the border is iterated, a uniform one fills the inside, anything else is split
+    in two along its longer side (the halves share the middle line) and tried again,
+    down to SUBDIVIDE_MIN_SIZE where the inside is just iterated.
+
+    The rectangles are done a level at a time, so the borders of all of them are queued
+    together and the kernels get full batches instead of a few pixels per rectangle.
+ */
+#define SUBDIVIDE_MIN_SIZE 6
+
+#define COUNT_UNKNOWN   (-1)
+#define COUNT_QUEUED    (-2)
+
+typedef struct
 {
-    #ifdef USE_CUDA
-        cuda_render_mandelbrot(
-            platform->pixels,
-            platform->screen_width,
-            platform->screen_height,
-            center_x,
-            center_y,
-            scale,
-            max_iterations
-        );
-    #else
-        render_mandelbrot_parallel(platform, center_x, center_y, scale, max_iterations);
-    #endif
-}
+    u32 x0, y0;
+    u32 x1, y1;     // inclusive
+} subdivide_rect_t;
 
-EXPORT void app_init(platform_api_t *platform, app_state_t *state) 
+typedef struct
 {
-    (void) platform;
+    tile_data_t *tile;
+    int *counts;                // one per pixel of the tile
+    float *smooth;
+    u32 stride;
 
-    state->initialized = true;
-    state->animation_time = 0.0f;
-    state->frame_count = 0;
+    u32 px[ESCAPE_BATCH];
+    u32 py[ESCAPE_BATCH];
+    int pending;
+} subdivide_t;
 
-    state->view_center_x = -0.637011;
-    state->view_center_y = -0.0395159;
-    state->view_scale = 0.002;
-    state->target_scale = 0.002;
+static int *subdivide_count(subdivide_t *s, u32 x, u32 y)
+{
+    return &s->counts[(y - s->tile->start_y) * s->stride + (x - s->tile->start_x)];
+}
 
-    state->is_panning = false;
-    state->pan_start_x = 0;
-    state->pan_start_y = 0;
-    state->pan_start_center_x = 0.0;
-    state->pan_start_center_y = 0.0;
+static float *subdivide_smooth(subdivide_t *s, u32 x, u32 y)
+{
+    return &s->smooth[(y - s->tile->start_y) * s->stride + (x - s->tile->start_x)];
+}
 
-    state->last_mouse_x = 0;
-    state->last_mouse_y = 0;
+static void subdivide_flush(subdivide_t *s)
+{
+    int iterations[ESCAPE_BATCH];
+    float smooth[ESCAPE_BATCH];
 
-    prof_init();
+    if (s->pending == 0)
+        return;
 
-    simple_font = init_simple_font((u32*)font_pixels);
+    tile_escape_time(s->tile, s->px, s->py, NULL, NULL, s->pending, iterations, smooth);
 
-    for (int i = 0; i < 512; ++i){
-        color_map[i] = rgb_from_wavelength(380.0 + (i * 400.0 / 512));
+    for (int i = 0; i < s->pending; ++i) {
+        *subdivide_count(s, s->px[i], s->py[i]) = iterations[i];
+        *subdivide_smooth(s, s->px[i], s->py[i]) = smooth[i];
     }
+    s->pending = 0;
+}
 
-    #ifdef USE_CUDA
-        if (cuda_is_available()) 
-        {
-            printf("[GPU] CUDA is available!\n");
-            cuda_print_info();
-            cuda_init(1920,1080);
-            state->use_gpu = true;
-        } 
-        else 
-        {
-            printf("[GPU] CUDA not available, using CPU fallback\n");
-            state->use_gpu = false;
-        }
-    #else
-        state->use_gpu = false;
-        printf("[GPU] Not compiled with CUDA support\n");
-    #endif
+static void subdivide_queue(subdivide_t *s, u32 x, u32 y)
+{
+    int *count = subdivide_count(s, x, y);
 
+    // already done as part of a neighbour's border
+    if (*count != COUNT_UNKNOWN)
+        return;
 
-    printf("[APP] Initialized!\n");
-}
+    *count = COUNT_QUEUED;
+    s->px[s->pending] = x;
+    s->py[s->pending] = y;
+
+    if (++s->pending == ESCAPE_BATCH) {
+        subdivide_flush(s);
+    }
+}
+
+static void subdivide_queue_border(subdivide_t *s, subdivide_rect_t r)
+{
+    for (u32 x = r.x0; x <= r.x1; ++x) {
+        subdivide_queue(s, x, r.y0);
+        subdivide_queue(s, x, r.y1);
+    }
+    for (u32 y = r.y0 + 1; y < r.y1; ++y) {
+        subdivide_queue(s, r.x0, y);
+        subdivide_queue(s, r.x1, y);
+    }
+}
+
+static bool subdivide_border_uniform(subdivide_t *s, subdivide_rect_t r)
+{
+    int first = *subdivide_count(s, r.x0, r.y0);
+
+    for (u32 x = r.x0; x <= r.x1; ++x) {
+        if (*subdivide_count(s, x, r.y0) != first || *subdivide_count(s, x, r.y1) != first)
+            return false;
+    }
+    for (u32 y = r.y0 + 1; y < r.y1; ++y) {
+        if (*subdivide_count(s, r.x0, y) != first || *subdivide_count(s, r.x1, y) != first)
+            return false;
+    }
+    return true;
+}
+
+/*
+    A uniform border with a known sample inside that disagrees is a small island the
+    border went around, the rectangle gets split instead of filled.
+ */
+static bool subdivide_inside_agrees(subdivide_t *s, subdivide_rect_t r)
+{
+    int first = *subdivide_count(s, r.x0, r.y0);
+
+    for (u32 y = r.y0 + 1; y < r.y1; ++y) {
+        for (u32 x = r.x0 + 1; x < r.x1; ++x) {
+            int count = *subdivide_count(s, x, y);
+            if (count != COUNT_UNKNOWN && count != first)
+                return false;
+        }
+    }
+    return true;
+}
+
+/*
+    The inside of a uniform rectangle has the border's count but not its smooth counts,
+    those are blended in from the four sides so a filled band keeps its gradient.
+ */
+static void subdivide_fill(subdivide_t *s, subdivide_rect_t r)
+{
+    int first = *subdivide_count(s, r.x0, r.y0);
+    float w = (float)(r.x1 - r.x0);
+    float h = (float)(r.y1 - r.y0);
+
+    for (u32 y = r.y0 + 1; y < r.y1; ++y)
+    {
+        float fy = (y - r.y0) / h;
+        float left = *subdivide_smooth(s, r.x0, y);
+        float right = *subdivide_smooth(s, r.x1, y);
+
+        for (u32 x = r.x0 + 1; x < r.x1; ++x)
+        {
+            float fx = (x - r.x0) / w;
+            float top = *subdivide_smooth(s, x, r.y0);
+            float bottom = *subdivide_smooth(s, x, r.y1);
+
+            *subdivide_count(s, x, y) = first;
+            *subdivide_smooth(s, x, y) = first >= s->tile->max_iterations ? SMOOTH_INSIDE :
+                                         0.5f * (left + (right - left) * fx + top + (bottom - top) * fy);
+        }
+    }
+}
+
+void render_tile_subdivided(tile_data_t *tile)
+{
+    u32 width = tile->end_x - tile->start_x;
+    u32 height = tile->end_y - tile->start_y;
+
+    subdivide_t s = {
+        .tile = tile,
+        .counts = malloc(width * height * sizeof(int)),
+        .smooth = malloc(width * height * sizeof(float)),
+        .stride = width
+    };
+
+    for (u32 i = 0; i < width * height; ++i) {
+        s.counts[i] = COUNT_UNKNOWN;
+    }
+
+    // samples the coarser levels really iterated are not done again
+    bool seeded = tile->done_step != 0;
+    if (seeded)
+    {
+        u32 done = tile->done_step;
+        for (u32 y = CEIL_DIV(tile->start_y, done) * done; y < tile->end_y; y += done) {
+            for (u32 x = CEIL_DIV(tile->start_x, done) * done; x < tile->end_x; x += done) {
+                u32 i = y * tile->width + x;
+                if (!tile->guessed || !tile->guessed[i]) {
+                    *subdivide_count(&s, x, y) = tile->counts[i];
+                    *subdivide_smooth(&s, x, y) = tile->smooth[i];
+                }
+            }
+        }
+    }
+
+    // the rectangles of a level have at least a pixel of inside each and do not overlap
+    subdivide_rect_t *storage = malloc(2 * width * height * sizeof(subdivide_rect_t));
+    subdivide_rect_t *rects = storage;
+    subdivide_rect_t *next = storage + width * height;
+    int rect_count = 1;
+
+    rects[0] = (subdivide_rect_t){ tile->start_x, tile->start_y, tile->end_x - 1, tile->end_y - 1 };
+
+    while (rect_count > 0 && !tile_stale(tile))
+    {
+        for (int i = 0; i < rect_count; ++i) {
+            subdivide_queue_border(&s, rects[i]);
+        }
+        subdivide_flush(&s);
+
+        int next_count = 0;
+
+        for (int i = 0; i < rect_count; ++i)
+        {
+            subdivide_rect_t r = rects[i];
+            u32 w = r.x1 - r.x0;
+            u32 h = r.y1 - r.y0;
+
+            if (w < 2 || h < 2)
+                continue;
+
+            if (subdivide_border_uniform(&s, r) && (!seeded || subdivide_inside_agrees(&s, r)))
+            {
+                subdivide_fill(&s, r);
+                tile->filled += (u64)(w - 1) * (h - 1);
+            }
+            else if (w <= SUBDIVIDE_MIN_SIZE && h <= SUBDIVIDE_MIN_SIZE)
+            {
+                // goes out with the next level's borders
+                for (u32 y = r.y0 + 1; y < r.y1; ++y) {
+                    for (u32 x = r.x0 + 1; x < r.x1; ++x) {
+                        subdivide_queue(&s, x, y);
+                    }
+                }
+            }
+            else if (w >= h)
+            {
+                u32 mid = r.x0 + w / 2;
+                next[next_count++] = (subdivide_rect_t){ r.x0, r.y0, mid, r.y1 };
+                next[next_count++] = (subdivide_rect_t){ mid, r.y0, r.x1, r.y1 };
+            }
+            else
+            {
+                u32 mid = r.y0 + h / 2;
+                next[next_count++] = (subdivide_rect_t){ r.x0, r.y0, r.x1, mid };
+                next[next_count++] = (subdivide_rect_t){ r.x0, mid, r.x1, r.y1 };
+            }
+        }
+
+        subdivide_rect_t *done = rects;
+        rects = next;
+        next = done;
+        rect_count = next_count;
+    }
+    subdivide_flush(&s);
+
+    for (u32 y = tile->start_y; y < tile->end_y && !tile->abandoned; ++y)
+    {
+        u32 i = y * tile->width + tile->start_x;
+        memcpy(&tile->counts[i], subdivide_count(&s, tile->start_x, y), width * sizeof(int));
+        memcpy(&tile->smooth[i], subdivide_smooth(&s, tile->start_x, y), width * sizeof(float));
+    }
+
+    free(storage);
+    free(s.smooth);
+    free(s.counts);
+}
+
+typedef struct
+{
+    u32 start_x, end_x;
+    u32 start_y, end_y;
+} tile_rect_t;
+
+// the number type for the pixels of rect
+static precision_t tile_precision(const deep_params_t *deep, double center_x, double center_y, double scale,
+                                  u32 width, u32 height, tile_rect_t rect)
+{
+    if (!deep || (!deep->ref && !deep->limbs))
+    {
+        // the corner furthest from the origin decides
+        double x0 = fabs(SCREEN_TO_COMPLEX(rect.start_x, center_x, width, scale));
+        double x1 = fabs(SCREEN_TO_COMPLEX(rect.end_x, center_x, width, scale));
+        double y0 = fabs(SCREEN_TO_COMPLEX(rect.start_y, center_y, height, scale));
+        double y1 = fabs(SCREEN_TO_COMPLEX(rect.end_y, center_y, height, scale));
+        return precision_for_spacing(scale, MAX(MAX(x0, x1), MAX(y0, y1)));
+    }
+    if (deep->ref) {
+        return deep->extended ? PRECISION_EXTENDED : PRECISION_PERTURBATION;
+    }
+    return PRECISION_DIRECT_HP;
+}
+
+void render_tile(void *data);
+void histogram_count_rect(equalize_t *eq, const int *counts, u32 width, u32 start_x, u32 end_x, u32 start_y, u32 end_y);
+
+// all or nothing, false when the frame is out of pieces
+static bool tile_split(tile_data_t *tile, const tile_rect_t *rects, int count)
+{
+    tile_pieces_t *pieces = tile->pieces;
+    if (!pieces)
+        return false;
+
+    int64_t end = atomic_add_i64(&pieces->used, count);
+    if (end > pieces->capacity)
+        return false;
+
+    for (int i = 0; i < count; ++i)
+    {
+        tile_data_t *piece = &pieces->tiles[end - count + i];
+        *piece = *tile;
+        piece->start_x = rects[i].start_x;
+        piece->end_x = rects[i].end_x;
+        piece->start_y = rects[i].start_y;
+        piece->end_y = rects[i].end_y;
+        piece->stats = (escape_stats_t){0};
+        piece->filled = 0;
+        piece->elapsed_ms = 0.0;
+
+        pool_submit(render_tile, piece);
+    }
+    return true;
+}
+
+// keeps the counts of a sample, the tile is coloured from them once it is done
+static void tile_store_sample(tile_data_t *tile, u32 sample_x, u32 sample_y, int iterations, float smooth)
+{
+    u32 block = tile->fill_blocks ? tile->step : 1;
+    u32 end_x = MIN(tile->end_x, sample_x + block);
+    u32 end_y = MIN(tile->end_y, sample_y + block);
+
+    for (u32 y = sample_y; y < end_y; ++y)
+    {
+        for (u32 x = sample_x; x < end_x; ++x)
+        {
+            tile->counts[y * tile->width + x] = iterations;
+            tile->smooth[y * tile->width + x] = smooth;
+        }
+    }
+}
+
+static void tile_store_samples(tile_data_t *tile, const u32 *px, const u32 *py, int count)
+{
+    int iterations[ESCAPE_BATCH];
+    float smooth[ESCAPE_BATCH];
+
+    tile_escape_time(tile, px, py, NULL, NULL, count, iterations, smooth);
+
+    for (int i = 0; i < count; ++i) {
+        tile_store_sample(tile, px[i], py[i], iterations[i], smooth[i]);
+    }
+}
+
+/*
+    Solid guessing, for frames that subdivide anyway: a new sample between samples of
+    the level before (left and right, above and below, or the four corners) that all
+    have the same count gets that count without iterating. Only the coarse levels
+    guess, the last one starts from the samples that were really iterated.
+    At the edge of the screen a sample can be down to one neighbour, that is iterated.
+ */
+static bool tile_guess_sample(tile_data_t *tile, u32 x, u32 y)
+{
+    u32 step = tile->step;
+    bool between_x = x % tile->done_step != 0;
+    bool between_y = y % tile->done_step != 0;
+
+    u32 nx[4], ny[4];
+    int n = 0;
+
+    for (int dy = -1; dy <= 1; dy += 2)
+    {
+        for (int dx = -1; dx <= 1; dx += 2)
+        {
+            // only the offsets along the axes the sample is between
+            if ((dx > 0 && !between_x) || (dy > 0 && !between_y))
+                continue;
+
+            u32 sx = between_x ? x + dx * (int)step : x;
+            u32 sy = between_y ? y + dy * (int)step : y;
+            if (sx < tile->width && sy < tile->height)
+            {
+                nx[n] = sx;
+                ny[n] = sy;
+                n++;
+            }
+        }
+    }
+
+    if (n < 2)
+        return false;
+
+    int count = tile->counts[ny[0] * tile->width + nx[0]];
+    float smooth = tile->smooth[ny[0] * tile->width + nx[0]];
+    for (int i = 1; i < n; ++i) {
+        if (tile->counts[ny[i] * tile->width + nx[i]] != count)
+            return false;
+        smooth += tile->smooth[ny[i] * tile->width + nx[i]];
+    }
+
+    tile_store_sample(tile, x, y, count, smooth / n);
+    tile->guessed[y * tile->width + x] = 1;
+    return true;
+}
+
+/*
+    Row by row, every tile->step-th pixel of every tile->step-th row and none that an
+    earlier level already did. Rows go into the vector kernel together, a whole row at
+    the finest level and several at once at the coarse ones.
+ */
+static void render_tile_rows(tile_data_t *tile)
+{
+    u32 step = tile->step;
+    u32 done = tile->done_step;
+
+    u32 px[ESCAPE_BATCH];
+    u32 py[ESCAPE_BATCH];
+    int pending = 0;
+
+    for (u32 y = CEIL_DIV(tile->start_y, step) * step; y < tile->end_y && !tile_stale(tile); y += step)
+    {
+        u32 rows_left = tile->end_y - y - 1;
+        if (rows_left >= 2 * TILE_SPLIT_MIN_SIZE && pool_wants_work())
+        {
+            u32 mid_y = CEIL_DIV(y + 1 + rows_left / 2, step) * step;
+            tile_rect_t rest = { tile->start_x, tile->end_x, mid_y, tile->end_y };
+            if (mid_y < tile->end_y && tile_split(tile, &rest, 1)) {
+                tile->end_y = mid_y;
+            }
+        }
+
+        bool row_done = done && y % done == 0;
+
+        for (u32 x = CEIL_DIV(tile->start_x, step) * step; x < tile->end_x; x += step)
+        {
+            if (row_done && x % done == 0)
+                continue;
+
+            if (done && tile->guessed && tile_guess_sample(tile, x, y))
+                continue;
+
+            px[pending] = x;
+            py[pending] = y;
+
+            if (++pending == ESCAPE_BATCH)
+            {
+                tile_store_samples(tile, px, py, pending);
+                pending = 0;
+            }
+        }
+    }
+
+    if (pending > 0 && !tile->abandoned) {
+        tile_store_samples(tile, px, py, pending);
+    }
+}
+
+void render_tile(void *data)
+{
+    tile_data_t *tile = (tile_data_t *)data;
+
+    u64 start = prof_get_time();
+
+    if (tile_stale(tile))
+        return;
+
+    while (pool_wants_work() &&
+           tile->end_x - tile->start_x >= 2 * TILE_SPLIT_MIN_SIZE &&
+           tile->end_y - tile->start_y >= 2 * TILE_SPLIT_MIN_SIZE)
+    {
+        // on the level's grid, so a sample's block never reaches into another piece
+        u32 mid_x = tile->start_x + (tile->end_x - tile->start_x) / 2;
+        u32 mid_y = tile->start_y + (tile->end_y - tile->start_y) / 2;
+        mid_x -= mid_x % tile->step;
+        mid_y -= mid_y % tile->step;
+
+        // keep the top left quarter
+        tile_rect_t rest[3] = {
+            { mid_x, tile->end_x, tile->start_y, mid_y },
+            { tile->start_x, mid_x, mid_y, tile->end_y },
+            { mid_x, tile->end_x, mid_y, tile->end_y }
+        };
+        if (!tile_split(tile, rest, 3))
+            break;
+
+        tile->end_x = mid_x;
+        tile->end_y = mid_y;
+    }
+
+    if (tile->subdivide && tile->step == 1) {
+        render_tile_subdivided(tile);
+    } else {
+        render_tile_rows(tile);
+    }
+
+    if (!tile->abandoned)
+    {
+        colorize_rect(tile->platform, tile->smooth, tile->coloring, tile->start_x, tile->end_x, tile->start_y, tile->end_y,
+                      tile->step, tile->fill_blocks);
+
+        if (tile->histogram) {
+            histogram_count_rect(tile->histogram, tile->counts, tile->width, tile->start_x, tile->end_x,
+                                 tile->start_y, tile->end_y);
+        }
+
+        if (tile->shown)
+        {
+            preview_screen_t *shown = tile->shown;
+            mutex_lock(&shown->lock);
+            for (u32 y = tile->start_y; y < tile->end_y; ++y)
+            {
+                u32 i = y * shown->width + tile->start_x;
+                memcpy(&shown->pixels[i], &tile->platform->pixels[i], (tile->end_x - tile->start_x) * sizeof(color_t));
+            }
+            mutex_unlock(&shown->lock);
+        }
+    }
+
+    tile->elapsed_ms = (double)(prof_get_time() - start) / 1000000.0;
+}
+
+/*
+    What each tile cost last frame, in ms, to hand this frame's tiles out longest first.
+    One very slow tile picked up last keeps the whole frame waiting, started first it
+    runs alongside everything else.
+
+    A small pan or zoom barely changes what a region costs, so the map is carried over
+    by looking up where each new tile's centre was last frame, tiles that were off
+    screen count as the most expensive since nothing is known about them.
+    The view is compared through the exact centre so it keeps working past a double.
+ */
+typedef struct
+{
+    float *cost;                // last frame, per tile
+    float *predicted;           // reprojected onto the current view
+    u32 tiles_x, tiles_y;
+    u32 width, height;
+    int max_iterations;
+    bool valid;                 // cost holds a finished frame
+    bool have_prediction;
+
+    // the view cost was measured at
+    hp_t center_x, center_y;
+    fe_t scale;
+} tile_cost_map_t;
+
+#define TILE_SIZE 64
+
+tile_cost_map_t g_tile_costs = {0};
+
+/*
+    The iteration counts of the last frame, and the smooth counts the pixels are coloured
+    from. A view that did not move is just coloured again from them (a new palette costs
+    a pass over the screen, not a frame), and so is most of a pan: the pan moves the centre
+    by whole pixels at the same scale, so most of the new frame is the old one shifted
+    over and only the strips that came into view need iterating.
+
+    frame_cache_prepare compares the view with the one the counts were made for and
+    shifts them in place, render_mandelbrot_parallel then only tiles the exposed
+    strips and colours the rest from the counts. Anything else (zoom, iteration cap,
+    a different renderer) and the whole frame is rendered and the counts refilled.
+
+    Before that whole frame the old counts are resampled into the new view (nearest
+    pixel) and shown at once as a preview, the tiles then go centre-out and replace
+    it as they finish. So the counts always cover the view they were made for, with
+    the exact ones, the resampled ones, or FRAME_COUNT_UNKNOWN where there is nothing,
+    and an abandoned frame still leaves something to preview the next one from.
+ */
+typedef struct
+{
+    int *counts;
+    float *smooth;
+    int *scratch;               // resampling goes through these
+    float *smooth_scratch;
+    u32 width, height;
+    int max_iterations;
+    int mode;                   // FRAME_CACHE_* of the renderer that filled it
+    bool valid;                 // counts hold a finished frame, all exact
+    u32 counts_version;         // moves on whenever the counts may change
+
+    hp_t center_x, center_y;
+    fe_t scale;
+
+    // this frame, new pixel (x, y) is old pixel (x + shift_x, y + shift_y)
+    bool reuse;
+    int shift_x, shift_y;
+
+    // this frame, the counts are a resampled preview (and on screen)
+    bool preview;
+
+    /*
+        Anti-aliasing, see antialias_edges. The edge pixels of a view that held still
+        for a frame, with AA_SAMPLES more smooth counts each, kept (and coloured again with
+        the rest) until the view moves. aa_budget is the sample cap they were picked
+        under, 0 when there are none yet.
+     */
+    u32 *aa_pixels;
+    float *aa_smooth;           // AA_SAMPLES per entry of aa_pixels
+    u32 aa_count;
+    u32 aa_budget;
+    u32 aa_samples;             // this frame's cap, from the state
+
+    /*
+        Temporal accumulation, see accumulate_round. Colour sums of every pixel's samples
+        so far while the view stays still, averaged with accum_coloring.
+     */
+    float *accum_sum;           // r, g, b per pixel
+    u16 *accum_count;
+    u8 *accum_stable;           // rounds in a row the average barely moved, ACCUM_CONVERGED when done
+    color_t *accum_pixels;      // the averages
+    coloring_t accum_coloring;
+    u32 accum_round;
+    bool accum_valid;
+    u32 accum_samples;          // this frame's cap per pixel, from the state
+} frame_cache_t;
+
+#define FRAME_COUNT_UNKNOWN (-1)     // SMOOTH_UNKNOWN in smooth, left as the background
+
+// how often the tiles finished so far are shown over a preview
+#define PREVIEW_PRESENT_MS 33.0
+
+// progressive frames start with every 8th pixel, a power of two
+#define PROGRESSIVE_FIRST_STEP 8
+
+// and are only worth it past this much predicted work per worker
+#define PROGRESSIVE_MIN_MS 250.0
+
+#define FRAME_CACHE_NONE            0       // gpu, does not fill the counts
+#define FRAME_CACHE_CPU             1
+#define FRAME_CACHE_PERTURBATION    2
+#define FRAME_CACHE_BLA             4
+#define FRAME_CACHE_DIRECT_HP       8
+#define FRAME_CACHE_SUBDIVISION     16
+
+frame_cache_t g_frame_cache = {0};
+
+typedef struct
+{
+    platform_api_t *platform;
+    const float *smooth;
+    const coloring_t *coloring;
+    u32 start_x, end_x;
+    u32 start_y, end_y;
+} colorize_job_t;
+
+// the part of the frame taken over from the last one (all of it for a palette change) only needs its colours
+void colorize_rows(void *data)
+{
+    colorize_job_t *job = (colorize_job_t *)data;
+    colorize_rect(job->platform, job->smooth, job->coloring, job->start_x, job->end_x, job->start_y, job->end_y, 1, false);
+}
+
+/*
+    The histogram of the escaped counts, counted by whatever puts them in the frame:
+    each tile counts its pixels once they are final (the last level), and the part of
+    a pan taken over from the last frame goes through histogram jobs alongside the
+    tiles. Every worker counts into bins of its own so no two ever touch the same ones,
+    equalize_finish adds them up after pool_wait.
+ */
+typedef struct
+{
+    u32 *bins;                  // max_iterations of them, 0 outside [low, high]
+    int low, high;              // the range of counts seen, high < low for none
+    u64 escaped;
+} histogram_bins_t;
+
+struct equalize_t
+{
+    float *cdf;                 // max_iterations + 1 entries
+    int max_iterations;
+    u32 counts_version;         // of the frame cache counts the cdf was made from
+
+    // one per worker and one for the calling thread, kept between frames
+    histogram_bins_t *workers;
+    int worker_count;
+
+    // this frame, rows [mirror_start, mirror_end) are copies of row conjugate_rows - y and count with it
+    u32 conjugate_rows;
+    u32 mirror_start, mirror_end;
+};
+
+equalize_t g_equalize = {0};
+
+void histogram_count_rect(equalize_t *eq, const int *counts, u32 width, u32 start_x, u32 end_x, u32 start_y, u32 end_y)
+{
+    // -1 is the calling thread, when the pool isn't running
+    histogram_bins_t *h = &eq->workers[pool_worker_index() + 1];
+    int max_iterations = eq->max_iterations;
+    int low = h->low, high = h->high;
+    u64 escaped = 0;
+
+    for (u32 y = start_y; y < end_y; ++y)
+    {
+        u32 partner = eq->conjugate_rows - y;
+        u32 weight = (y <= eq->conjugate_rows && partner >= eq->mirror_start && partner < eq->mirror_end) ? 2 : 1;
+
+        const int *row = &counts[y * width];
+        for (u32 x = start_x; x < end_x; ++x)
+        {
+            int count = row[x];
+
+            // FRAME_COUNT_UNKNOWN and the inside
+            if (count < 0 || count >= max_iterations)
+                continue;
+
+            h->bins[count] += weight;
+            low = MIN(low, count);
+            high = MAX(high, count);
+            escaped += weight;
+        }
+    }
+
+    h->low = low;
+    h->high = high;
+    h->escaped += escaped;
+}
+
+typedef struct
+{
+    equalize_t *eq;
+    const int *counts;
+    u32 width;
+    tile_rect_t rect;
+} histogram_job_t;
+
+void count_histogram(void *data)
+{
+    histogram_job_t *job = (histogram_job_t *)data;
+    histogram_count_rect(job->eq, job->counts, job->width, job->rect.start_x, job->rect.end_x,
+                         job->rect.start_y, job->rect.end_y);
+}
+
+/*
+    Gets g_equalize ready to count this frame's histogram, false when the cdf was made
+    from these very counts and there is nothing to count. The bins are cleared here,
+    only the range each worker touched last time (an abandoned frame's included).
+ */
+bool equalize_begin(const frame_cache_t *cache, int max_iterations, u32 conjugate_rows, u32 mirror_start, u32 mirror_end)
+{
+    equalize_t *eq = &g_equalize;
+    int worker_count = pool_thread_count() + 1;
+
+    if (eq->cdf && eq->max_iterations == max_iterations &&
+        eq->counts_version == cache->counts_version) {
+        return false;
+    }
+
+    if (eq->max_iterations != max_iterations || eq->worker_count != worker_count)
+    {
+        for (int w = 0; w < eq->worker_count; ++w) {
+            free(eq->workers[w].bins);
+        }
+        free(eq->workers);
+        free(eq->cdf);
+
+        eq->cdf = malloc((max_iterations + 1) * sizeof(float));
+        eq->workers = calloc(worker_count, sizeof(histogram_bins_t));
+        for (int w = 0; w < worker_count; ++w) {
+            // mostly never touched, a deep view only uses a narrow range of counts
+            eq->workers[w].bins = calloc(max_iterations, sizeof(u32));
+            eq->workers[w].high = -1;
+        }
+        eq->max_iterations = max_iterations;
+        eq->worker_count = worker_count;
+    }
+
+    for (int w = 0; w < worker_count; ++w)
+    {
+        histogram_bins_t *h = &eq->workers[w];
+        if (h->high >= h->low) {
+            memset(h->bins + h->low, 0, (h->high - h->low + 1) * sizeof(u32));
+        }
+        h->low = max_iterations;
+        h->high = -1;
+        h->escaped = 0;
+    }
+
+    eq->conjugate_rows = conjugate_rows;
+    eq->mirror_start = mirror_start;
+    eq->mirror_end = mirror_end;
+    return true;
+}
+
+/*
+    Adds up the workers' bins and rebuilds the cdf, entry n is max_iterations times the
+    fraction of the escaped pixels below count n.
+ */
+void equalize_finish(const frame_cache_t *cache)
+{
+    equalize_t *eq = &g_equalize;
+    int max_iterations = eq->max_iterations;
+
+    int low = max_iterations, high = -1;
+    u64 escaped = 0;
+    for (int w = 0; w < eq->worker_count; ++w)
+    {
+        low = MIN(low, eq->workers[w].low);
+        high = MAX(high, eq->workers[w].high);
+        escaped += eq->workers[w].escaped;
+    }
+
+    if (escaped == 0)
+    {
+        // nothing to spread, the plain mapping
+        for (int n = 0; n <= max_iterations; ++n) {
+            eq->cdf[n] = (float)n;
+        }
+    }
+    else
+    {
+        u64 below = 0;
+        for (int n = 0; n <= max_iterations; ++n)
+        {
+            eq->cdf[n] = (float)((double)below / (double)escaped * max_iterations);
+
+            if (n >= low && n <= high) {
+                for (int w = 0; w < eq->worker_count; ++w) {
+                    below += eq->workers[w].bins[n];
+                }
+            }
+        }
+    }
+
+    eq->counts_version = cache->counts_version;
+}
+
+typedef struct
+{
+    float cost;
+    u32 index;
+} tile_order_t;
+
+static int compare_tile_cost(const void *a, const void *b)
+{
+    float ca = ((const tile_order_t *)a)->cost;
+    float cb = ((const tile_order_t *)b)->cost;
+    return (ca < cb) - (ca > cb);
+}
+
+// rows [start, end) are copied from their conjugates, row y from row conjugate_rows - y
+static void mirror_rows(platform_api_t *platform, frame_cache_t *cache, u32 conjugate_rows, u32 start, u32 end)
+{
+    u32 width = platform->screen_width;
+
+    for (u32 y = start; y < end; ++y)
+    {
+        u32 from = conjugate_rows - y;
+        memcpy(&platform->pixels[y * width], &platform->pixels[from * width], width * sizeof(color_t));
+        memcpy(&cache->counts[y * width], &cache->counts[from * width], width * sizeof(int));
+        memcpy(&cache->smooth[y * width], &cache->smooth[from * width], width * sizeof(float));
+    }
+}
+
+/*
+    Adaptive anti-aliasing: once a view has held still for a frame, the pixels whose
+    colour differs from a neighbour's by more than AA_EDGE_CONTRAST (the summed r, g, b
+    difference, the edge of the set always counts) get AA_SAMPLES more samples at
+    jittered spots inside them, and are shown as the average colour of all of them.
+    A frame spends at most aa_samples extra samples, the highest contrast pixels first,
+    so the cost goes with how much edge there is, not with the size of the screen.
+    The samples are smooth counts like the rest, a new palette averages them again.
+ */
+#define AA_SAMPLES 8
+#define AA_EDGE_CONTRAST 48
+#define AA_CONTRAST_LEVELS (3 * 255 + 2)    // the last one for the edge of the set
+#define AA_JOB_PIXELS 64
+
+// the 'A' key steps the sample cap through these, then off
+#define AA_SAMPLES_FIRST (1 << 16)
+#define AA_SAMPLES_LIMIT (1 << 20)
+
+typedef struct
+{
+    tile_data_t tile;           // the view and the number type, the rect covers the pixels
+    const u32 *pixels;
+    float *smooth;              // samples per pixel
+    u32 count;
+    u32 samples;                // AA_SAMPLES, or 1 for an accumulation round
+    u32 round;                  // that round, see accumulate_sample_offset
+} aa_job_t;
+
+/*
+    Stratified: sample s sits in one of the 8 outer cells of a 3x3 grid over the pixel
+    (the middle one is the pixel's own sample), somewhere in it picked by a hash.
+ */
+static void aa_sample_offset(u32 pixel, int sample, float *dx, float *dy)
+{
+    u32 h = pixel * AA_SAMPLES + (u32)sample;
+    h ^= h >> 16; h *= 0x7feb352dU;
+    h ^= h >> 15; h *= 0x846ca68bU;
+    h ^= h >> 16;
+
+    int cell = sample < 4 ? sample : sample + 1;
+    *dx = ((float)(cell % 3) + (float)(h & 0xffff) / 65536.0f) / 3.0f - 0.5f;
+    *dy = ((float)(cell / 3) + (float)(h >> 16) / 65536.0f) / 3.0f - 0.5f;
+}
+
+/*
+    Round n of the accumulation puts every pixel's sample at the n-th point of the R2
+    sequence (evenly spread over the pixel for any number of rounds), shifted by a
+    per pixel hash so neighbours don't all sample the same spot.
+ */
+static void accumulate_sample_offset(u32 pixel, u32 round, float *dx, float *dy)
+{
+    const double a1 = 0.7548776662466927;   // 1 / g, 1 / g^2 for the plastic number g
+    const double a2 = 0.5698402909980532;
+
+    u32 h = pixel ^ 0x9e3779b9U;
+    h ^= h >> 16; h *= 0x7feb352dU;
+    h ^= h >> 15; h *= 0x846ca68bU;
+    h ^= h >> 16;
+
+    double x = (double)(h & 0xffff) / 65536.0 + a1 * round;
+    double y = (double)(h >> 16) / 65536.0 + a2 * round;
+    *dx = (float)(x - floor(x)) - 0.5f;
+    *dy = (float)(y - floor(y)) - 0.5f;
+}
+
+void antialias_pixels(void *data)
+{
+    aa_job_t *job = (aa_job_t *)data;
+    tile_data_t *tile = &job->tile;
+    u32 width = tile->width;
+
+    u32 px[ESCAPE_BATCH];
+    u32 py[ESCAPE_BATCH];
+    float dx[ESCAPE_BATCH];
+    float dy[ESCAPE_BATCH];
+    int iterations[ESCAPE_BATCH];
+
+    const u32 per_batch = ESCAPE_BATCH / job->samples;
+
+    for (u32 i = 0; i < job->count && !tile_stale(tile); i += per_batch)
+    {
+        u32 count = MIN(per_batch, job->count - i);
+
+        for (u32 p = 0; p < count; ++p)
+        {
+            u32 pixel = job->pixels[i + p];
+            for (u32 k = 0; k < job->samples; ++k)
+            {
+                u32 j = p * job->samples + k;
+                px[j] = pixel % width;
+                py[j] = pixel / width;
+
+                if (job->round > 0) {
+                    accumulate_sample_offset(pixel, job->round, &dx[j], &dy[j]);
+                } else {
+                    aa_sample_offset(pixel, (int)k, &dx[j], &dy[j]);
+                }
+            }
+        }
+
+        tile_escape_time(tile, px, py, dx, dy, (int)(count * job->samples), iterations, &job->smooth[i * job->samples]);
+    }
+}
+
+/*
+    samples smooth counts for each of the pixels (in screen order) on the workers, base has
+    everything of a tile but the rect and the number type. round is for accumulate_sample_offset,
+    0 takes the AA_SAMPLES of the edge pattern. false if the view moved on first.
+ */
+static bool sample_pixels(const tile_data_t *base, const u32 *pixels, u32 count, u32 samples, u32 round,
+                          float *smooth, render_stats_t *stats)
+{
+    u32 width = base->width;
+    u32 job_pixels = AA_JOB_PIXELS * AA_SAMPLES / samples;
+    u32 job_count = CEIL_DIV(count, job_pixels);
+    aa_job_t *jobs = malloc(MAX(1, job_count) * sizeof(aa_job_t));
+
+    for (u32 j = 0; j < job_count; ++j)
+    {
+        u32 first = j * job_pixels;
+        u32 n = MIN(job_pixels, count - first);
+
+        // the rows between the first and the last pixel bound them
+        tile_rect_t rect = { 0, width, pixels[first] / width, pixels[first + n - 1] / width + 1 };
+
+        jobs[j] = (aa_job_t){
+            .tile = *base,
+            .pixels = &pixels[first],
+            .smooth = &smooth[first * samples],
+            .count = n,
+            .samples = samples,
+            .round = round
+        };
+        jobs[j].tile.start_x = rect.start_x;
+        jobs[j].tile.end_x = rect.end_x;
+        jobs[j].tile.start_y = rect.start_y;
+        jobs[j].tile.end_y = rect.end_y;
+        jobs[j].tile.precision = tile_precision(&base->deep, base->center_x, base->center_y, base->scale, width, base->height, rect);
+
+        pool_submit(antialias_pixels, &jobs[j]);
+    }
+    pool_wait();
+
+    bool abandoned = false;
+    for (u32 j = 0; j < job_count; ++j)
+    {
+        abandoned |= jobs[j].tile.abandoned;
+        stats->escape.interior_skipped += jobs[j].tile.stats.interior_skipped;
+        stats->escape.cycle_points += jobs[j].tile.stats.cycle_points;
+        stats->escape.cycle_iterations_saved += jobs[j].tile.stats.cycle_iterations_saved;
+        stats->escape.rebases += jobs[j].tile.stats.rebases;
+        stats->escape.bla_iterations_skipped += jobs[j].tile.stats.bla_iterations_skipped;
+    }
+    free(jobs);
+
+    return !abandoned;
+}
+
+static inline u32 color_contrast(color_t a, color_t b)
+{
+    return (u32)(abs(a.r - b.r) + abs(a.g - b.g) + abs(a.b - b.b));
+}
+
+/*
+    Picks the edge pixels of the finished frame (coloured, on screen) and samples them on
+    the workers, base has everything of a tile but the rect and the number type.
+    false if the view moved on first.
+ */
+static bool antialias_edges(platform_api_t *platform, frame_cache_t *cache, const tile_data_t *base, render_stats_t *stats)
+{
+    u32 width = platform->screen_width;
+    u32 height = platform->screen_height;
+    const color_t *pixels = platform->pixels;
+    const float *smooth = cache->smooth;
+
+    // each pixel's largest difference to any of its 4 neighbours
+    u16 *contrast = calloc(width * height, sizeof(u16));
+    for (u32 y = 0; y < height; ++y)
+    {
+        for (u32 x = 0; x < width; ++x)
+        {
+            u32 i = y * width + x;
+            if (smooth[i] < 0.0f)
+                continue;
+
+            u32 neighbours[2] = { x + 1 < width ? i + 1 : i, y + 1 < height ? i + width : i };
+            for (int n = 0; n < 2; ++n)
+            {
+                u32 j = neighbours[n];
+                if (j == i || smooth[j] < 0.0f)
+                    continue;
+
+                u32 c = (smooth[i] == SMOOTH_INSIDE) != (smooth[j] == SMOOTH_INSIDE) ?
+                        AA_CONTRAST_LEVELS - 1 : color_contrast(pixels[i], pixels[j]);
+                contrast[i] = (u16)MAX(contrast[i], c);
+                contrast[j] = (u16)MAX(contrast[j], c);
+            }
+        }
+    }
+
+    // over the cap the cutoff goes up from AA_EDGE_CONTRAST until the rest fits
+    u32 *levels = calloc(AA_CONTRAST_LEVELS, sizeof(u32));
+    for (u32 i = 0; i < width * height; ++i) {
+        if (contrast[i] >= AA_EDGE_CONTRAST) {
+            levels[contrast[i]]++;
+        }
+    }
+
+    u32 capacity = cache->aa_samples / AA_SAMPLES;
+    u32 taken = 0;
+    u32 cutoff = AA_CONTRAST_LEVELS;
+    while (cutoff > AA_EDGE_CONTRAST && taken + levels[cutoff - 1] <= capacity) {
+        taken += levels[--cutoff];
+    }
+
+    // what is left goes to the level just under the cutoff, in screen order
+    u32 room = cutoff > AA_EDGE_CONTRAST ? capacity - taken : 0;
+    u32 count = 0;
+
+    cache->aa_pixels = realloc(cache->aa_pixels, MAX(1, taken + room) * sizeof(u32));
+    for (u32 i = 0; i < width * height; ++i)
+    {
+        if (contrast[i] >= cutoff) {
+            cache->aa_pixels[count++] = i;
+        } else if (room > 0 && contrast[i] == cutoff - 1) {
+            cache->aa_pixels[count++] = i;
+            room--;
+        }
+    }
+    free(levels);
+    free(contrast);
+
+    cache->aa_smooth = realloc(cache->aa_smooth, MAX(1, count) * AA_SAMPLES * sizeof(float));
+
+    if (!sample_pixels(base, cache->aa_pixels, count, AA_SAMPLES, 0, cache->aa_smooth, stats))
+    {
+        cache->aa_count = 0;
+        cache->aa_budget = 0;
+        return false;
+    }
+
+    cache->aa_count = count;
+    cache->aa_budget = cache->aa_samples;
+    stats->aa_samples = (u64)count * AA_SAMPLES;
+    return true;
+}
+
+// the edge pixels become the average colour of their samples
+static void antialias_apply(platform_api_t *platform, const frame_cache_t *cache, const coloring_t *coloring)
+{
+    for (u32 e = 0; e < cache->aa_count; ++e)
+    {
+        u32 pixel = cache->aa_pixels[e];
+        const float *samples = &cache->aa_smooth[e * AA_SAMPLES];
+
+        color_t color = coloring_apply(coloring, cache->smooth[pixel]);
+        u32 r = color.r, g = color.g, b = color.b;
+        for (int k = 0; k < AA_SAMPLES; ++k)
+        {
+            color = coloring_apply(coloring, samples[k]);
+            r += color.r;
+            g += color.g;
+            b += color.b;
+        }
+
+        const u32 total = AA_SAMPLES + 1;
+        platform->pixels[pixel] = make_color((u8)((r + total / 2) / total), (u8)((g + total / 2) / total), (u8)((b + total / 2) / total));
+    }
+}
+
+/*
+    Temporal accumulation: a view that stays still keeps getting better instead of being
+    drawn the same again every frame. Each still frame takes one more sample per pixel,
+    at another jittered spot every round, and shows the running average of all of them
+    (the pixel's own sample and its edge samples included).
+    A pixel stops once ACCUM_STABLE_ROUNDS rounds in a row moved its average by less than
+    ACCUM_TOLERANCE (summed r, g, b) or it has accum_samples, so the flat areas drop out
+    after a couple of rounds and the edges go on. With no pixel left a still frame is
+    a copy of the averages. They are colours, a change to the colouring starts over.
+ */
+#define ACCUM_TOLERANCE 0.75f
+#define ACCUM_STABLE_ROUNDS 2
+#define ACCUM_CONVERGED 255
+
+// the 'T' key switches between this and off
+#define ACCUM_SAMPLES_DEFAULT 64
+
+static bool coloring_same(const coloring_t *a, const coloring_t *b)
+{
+    return a->palette == b->palette && a->max_iterations == b->max_iterations &&
+           a->density == b->density && a->offset == b->offset && a->equalize == b->equalize;
+}
+
+// from the frame on screen, the edge pixels weigh as many samples as they averaged
+static void accumulate_start(platform_api_t *platform, frame_cache_t *cache, const coloring_t *coloring)
+{
+    u32 pixels = platform->screen_width * platform->screen_height;
+
+    for (u32 i = 0; i < pixels; ++i)
+    {
+        color_t color = platform->pixels[i];
+        cache->accum_sum[3 * i + 0] = color.r;
+        cache->accum_sum[3 * i + 1] = color.g;
+        cache->accum_sum[3 * i + 2] = color.b;
+        cache->accum_count[i] = 1;
+        cache->accum_stable[i] = cache->smooth[i] < 0.0f ? ACCUM_CONVERGED : 0;
+        cache->accum_pixels[i] = color;
+    }
+
+    for (u32 e = 0; e < cache->aa_count; ++e)
+    {
+        u32 i = cache->aa_pixels[e];
+        for (int c = 0; c < 3; ++c) {
+            cache->accum_sum[3 * i + c] *= AA_SAMPLES + 1;
+        }
+        cache->accum_count[i] = AA_SAMPLES + 1;
+    }
+
+    cache->accum_coloring = *coloring;
+    cache->accum_round = 0;
+    cache->accum_valid = true;
+}
+
+// one more sample for every pixel still going, false if the view moved on first
+static bool accumulate_round(platform_api_t *platform, frame_cache_t *cache, const tile_data_t *base,
+                             const coloring_t *coloring, render_stats_t *stats)
+{
+    u32 pixels = platform->screen_width * platform->screen_height;
+
+    u32 *active = malloc(pixels * sizeof(u32));
+    u32 count = 0;
+    for (u32 i = 0; i < pixels; ++i) {
+        if (cache->accum_stable[i] != ACCUM_CONVERGED && cache->accum_count[i] < cache->accum_samples) {
+            active[count++] = i;
+        }
+    }
+
+    bool complete = true;
+    if (count > 0)
+    {
+        float *smooth = malloc(count * sizeof(float));
+        u32 round = cache->accum_round + 1;
+
+        complete = sample_pixels(base, active, count, 1, round, smooth, stats);
+        if (complete)
+        {
+            for (u32 k = 0; k < count; ++k)
+            {
+                u32 i = active[k];
+                float *sum = &cache->accum_sum[3 * i];
+                color_t color = coloring_apply(coloring, smooth[k]);
+                float sample[3] = { color.r, color.g, color.b };
+
+                // the average moves by (sample - average) / n
+                float n = (float)++cache->accum_count[i];
+                float moved = 0.0f;
+                for (int c = 0; c < 3; ++c)
+                {
+                    moved += fabsf(sample[c] - sum[c] / (n - 1.0f)) / n;
+                    sum[c] += sample[c];
+                }
+
+                cache->accum_pixels[i] = make_color((u8)(sum[0] / n + 0.5f), (u8)(sum[1] / n + 0.5f), (u8)(sum[2] / n + 0.5f));
+
+                u8 stable = moved < ACCUM_TOLERANCE ? cache->accum_stable[i] + 1 : 0;
+                cache->accum_stable[i] = stable >= ACCUM_STABLE_ROUNDS ? ACCUM_CONVERGED : stable;
+            }
+
+            cache->accum_round = round;
+            stats->accumulated = count;
+        }
+        free(smooth);
+    }
+    free(active);
+
+    stats->accum_round = cache->accum_round;
+    return complete;
+}
+
+/*
+    false when the view changed before the frame was done, the screen holds a partial frame then.
+    conjugate_rows is from view_conjugate_rows. The tiles go into the frame cache, which
+    frame_cache_prepare has set up for this view.
+ */
+bool render_mandelbrot_parallel(platform_api_t *platform, const coloring_t *coloring, double center_x, double center_y, double scale,
+                                int max_iterations, const deep_params_t *deep, bool subdivide, u32 conjugate_rows)
+{
+    u32 height  = platform->screen_height;
+    u32 width   = platform->screen_width;
+    int64_t generation = g_frame_generation;
+
+    // slice the screen up to 64x64 px tiles
+    const u32 tile_size = TILE_SIZE;
+
+    u32 tiles_x = CEIL_DIV(width, tile_size);
+    u32 tiles_y = CEIL_DIV(height, tile_size);
+    u32 grid_tiles = tiles_x * tiles_y;
+
+    frame_cache_t *cache = &g_frame_cache;
+    bool reuse = cache->reuse;
+    bool preview = cache->preview;
+
+    /*
+        With the real axis on a row, the rows past it that have their conjugate on screen
+        are copied over instead of iterated, the tiles cover the rest above and below.
+        A pan has its strips to do and nothing else, not worth it there.
+     */
+    u32 mirror_start = conjugate_rows / 2 + 1;
+    u32 mirror_end = MIN(height, conjugate_rows + 1);
+    bool mirror = !reuse && conjugate_rows && mirror_start < mirror_end;
+
+    /*
+        Reusing a panned frame leaves the strips that came into view, top and bottom
+        across the whole width and left and right between them, the rest is taken over.
+     */
+    tile_rect_t rects[4];
+    int rect_count = 0;
+    tile_rect_t kept = { 0, width, 0, height };
+
+    if (reuse)
+    {
+        kept.start_x = (u32)MAX(0, -cache->shift_x);
+        kept.end_x = (u32)MIN((int)width, (int)width - cache->shift_x);
+        kept.start_y = (u32)MAX(0, -cache->shift_y);
+        kept.end_y = (u32)MIN((int)height, (int)height - cache->shift_y);
+
+        rects[rect_count++] = (tile_rect_t){ 0, width, 0, kept.start_y };
+        rects[rect_count++] = (tile_rect_t){ 0, width, kept.end_y, height };
+        rects[rect_count++] = (tile_rect_t){ 0, kept.start_x, kept.start_y, kept.end_y };
+        rects[rect_count++] = (tile_rect_t){ kept.end_x, width, kept.start_y, kept.end_y };
+    }
+    else if (mirror)
+    {
+        rects[rect_count++] = (tile_rect_t){ 0, width, 0, mirror_start };
+        rects[rect_count++] = (tile_rect_t){ 0, width, mirror_end, height };
+    }
+    else
+    {
+        rects[rect_count++] = (tile_rect_t){ 0, width, 0, height };
+    }
+
+    // a view that held still, every pixel comes from the last frame
+    bool still = reuse && cache->shift_x == 0 && cache->shift_y == 0;
+
+    // and has been accumulating with these colours, the averages are the frame (see accumulate_round)
+    bool accumulated = still && cache->accum_valid && cache->accum_samples > 0 &&
+                       coloring_same(&cache->accum_coloring, coloring) && cache->aa_budget == cache->aa_samples;
+
+    // strips can straddle the grid, each one starts its own row of tiles
+    u32 max_tiles = grid_tiles + 2 * (tiles_x + tiles_y) + 4;
+    tile_data_t* tiles = malloc(max_tiles * (1 + TILE_PIECES_PER_TILE) * sizeof(tile_data_t));
+
+    tile_pieces_t pieces = {
+        .tiles = tiles + max_tiles,
+        .capacity = max_tiles * TILE_PIECES_PER_TILE
+    };
+
+    u32 tile_idx = 0;
+
+    for (int r = 0; r < rect_count; r++)
+    {
+        for (u32 start_y = rects[r].start_y; start_y < rects[r].end_y; start_y += tile_size) 
+        {
+            u32 end_y = MIN(rects[r].end_y, start_y + tile_size);
+        
+            for (u32 start_x = rects[r].start_x; start_x < rects[r].end_x; start_x += tile_size) 
+            {
+                u32 end_x = MIN(rects[r].end_x, (start_x + tile_size)); 
+
+                precision_t precision = tile_precision(deep, center_x, center_y, scale, width, height,
+                                                       (tile_rect_t){ start_x, end_x, start_y, end_y });
+            
+                tiles[tile_idx] = (tile_data_t){
+                    .start_x = start_x, .end_x = end_x,
+                    .start_y = start_y, .end_y = end_y,
+                    .width = width, .height = height,
+                    .platform = platform,
+                    .max_iterations = max_iterations,
+                    .center_x = center_x,
+                    .center_y = center_y,
+                    .scale  = scale,
+                    .deep = deep ? *deep : (deep_params_t){0},
+                    .precision = precision,
+                    .subdivide = subdivide,
+                    .pieces = &pieces,
+                    .index = (start_y / tile_size) * tiles_x + start_x / tile_size,
+                    .counts = cache->counts,
+                    .smooth = cache->smooth,
+                    .coloring = coloring,
+                    .generation = generation
+                };
+            
+                tile_idx++;
+            }
+        }
+    }
+
+    u32 total_tiles = tile_idx;
+
+    // the cost map is only refilled from a whole frame of grid aligned tiles
+    tile_cost_map_t *costs = &g_tile_costs;
+    bool same_grid = costs->tiles_x == tiles_x && costs->tiles_y == tiles_y;
+    bool full_grid = !reuse && !mirror && same_grid;
+    bool predicted = !reuse && same_grid && costs->have_prediction;
+
+    tile_order_t *order = malloc(total_tiles * sizeof(tile_order_t));
+    for (u32 i = 0; i < total_tiles; i++)
+    {
+        float cost = predicted ? costs->predicted[tiles[i].index] : 0.0f;
+
+        // over a preview the middle of the screen gets sharp first, that is where the eye is
+        if (preview)
+        {
+            float dx = 0.5f * (tiles[i].start_x + tiles[i].end_x) - 0.5f * width;
+            float dy = 0.5f * (tiles[i].start_y + tiles[i].end_y) - 0.5f * height;
+            cost = -(dx * dx + dy * dy);
+        }
+        order[i] = (tile_order_t){ cost, i };
+    }
+
+    // longest (or closest) first, stays in screen order without a prediction
+    if (predicted || preview) {
+        qsort(order, total_tiles, sizeof(tile_order_t), compare_tile_cost);
+    }
+
+    /*
+        Progressive: the frame goes out a level at a time, every 8th pixel on both axes
+        first, then every 4th, 2nd and finally all of them, each level only iterating
+        the pixels the ones before did not and shown as soon as it is done. So something
+        is up after 1/64 of the work however deep the view, and a view change drops the
+        frame between any two rows of any level.
+        The levels cost extra work in the end, so only for a frame that is going to take
+        a while: by the cost map when there is a prediction, by the depth when there is
+        not. A pan's strips are done in one go, and so is a frame over a preview, that
+        already has something on screen.
+     */
+    bool slow = false;
+    if (predicted)
+    {
+        float predicted_ms = 0.0f;
+        for (u32 i = 0; i < total_tiles; i++) {
+            predicted_ms += costs->predicted[tiles[i].index];
+        }
+        slow = predicted_ms / MAX(1, pool_thread_count()) >= PROGRESSIVE_MIN_MS;
+    }
+    else
+    {
+        slow = deep && (deep->ref || deep->limbs);
+    }
+    u32 first_step = (!reuse && !preview && slow && platform->present) ? PROGRESSIVE_FIRST_STEP : 1;
+
+    // splitting changes the tiles, every level starts over from the same layout
+    tile_data_t *layout = NULL;
+    u8 *guessed = NULL;
+    if (first_step > 1)
+    {
+        layout = malloc(total_tiles * sizeof(tile_data_t));
+        memcpy(layout, tiles, total_tiles * sizeof(tile_data_t));
+
+        // guessing reads the neighbours back from the counts
+        if (subdivide) {
+            guessed = calloc(width * height, sizeof(u8));
+        }
+    }
+
+    // added up over the levels, they only replace the last frame's once this one is done
+    render_stats_t stats = { .pixels = (u64)width * height };
+    if (reuse) {
+        stats.reused = (u64)(kept.end_x - kept.start_x) * (kept.end_y - kept.start_y);
+    }
+    if (mirror) {
+        stats.mirrored = (u64)(mirror_end - mirror_start) * width;
+    }
+
+    float *frame_costs = calloc(grid_tiles, sizeof(float));
+    double elapsed_ms[PRECISION_COUNT] = {0};
+
+    // equalized frames count the histogram as the pixels come in, see equalize_begin
+    equalize_t *histogram = NULL;
+    if (coloring->equalize && !accumulated &&
+        equalize_begin(cache, max_iterations, mirror ? conjugate_rows : 0, mirror_start, mirror_end)) {
+        histogram = &g_equalize;
+    }
+
+    // starts out as the preview already on screen, the workers aren't running yet
+    preview_screen_t *shown = NULL;
+    if (preview && platform->present)
+    {
+        shown = &g_preview_screen;
+        if (shown->width != width || shown->height != height)
+        {
+            free(shown->pixels);
+            shown->pixels = malloc(width * height * sizeof(color_t));
+            shown->width = width;
+            shown->height = height;
+        }
+        memcpy(shown->pixels, platform->pixels, width * height * sizeof(color_t));
+    }
+
+    for (u32 step = first_step; step >= 1; step /= 2)
+    {
+        if (step != first_step) {
+            memcpy(tiles, layout, total_tiles * sizeof(tile_data_t));
+        }
+        atomic_store_i64(&pieces.used, 0);
+
+        for (u32 i = 0; i < total_tiles; i++)
+        {
+            tiles[i].step = step;
+            tiles[i].done_step = step < first_step ? 2 * step : 0;
+            tiles[i].fill_blocks = step > 1 && !preview;
+            tiles[i].guessed = guessed;
+            tiles[i].shown = shown;
+            tiles[i].histogram = step == 1 ? histogram : NULL;
+        }
+
+        u32 recolor_count = 0;
+        colorize_job_t *recolor = NULL;
+        u32 counted_count = 0;
+        histogram_job_t *counted = NULL;
+
+        PROFILE("Queueing tiles")
+        {
+            for (u32 i = 0; i < total_tiles; i++) {
+                pool_submit(render_tile, &tiles[order[i].index]);
+            }
+
+            // with equalization the whole frame is recoloured once it is done
+            if (reuse && !coloring->equalize && !accumulated && kept.start_x < kept.end_x && kept.start_y < kept.end_y)
+            {
+                recolor = malloc(tiles_y * sizeof(colorize_job_t));
+                for (u32 y = kept.start_y; y < kept.end_y; y += tile_size)
+                {
+                    recolor[recolor_count] = (colorize_job_t){
+                        .platform = platform,
+                        .smooth = cache->smooth,
+                        .coloring = coloring,
+                        .start_x = kept.start_x, .end_x = kept.end_x,
+                        .start_y = y, .end_y = MIN(kept.end_y, y + tile_size)
+                    };
+                    pool_submit(colorize_rows, &recolor[recolor_count++]);
+                }
+            }
+
+            // the tiles count themselves, what a pan kept from the last frame is counted alongside them
+            if (histogram && reuse && kept.start_x < kept.end_x && kept.start_y < kept.end_y)
+            {
+                counted = malloc(tiles_y * sizeof(histogram_job_t));
+                for (u32 y = kept.start_y; y < kept.end_y; y += tile_size)
+                {
+                    counted[counted_count] = (histogram_job_t){
+                        .eq = histogram,
+                        .counts = cache->counts,
+                        .width = width,
+                        .rect = { kept.start_x, kept.end_x, y, MIN(kept.end_y, y + tile_size) }
+                    };
+                    pool_submit(count_histogram, &counted[counted_count++]);
+                }
+            }
+        }
+
+        PROFILE("Waiting for tiles")
+        {
+            // tiles replace the preview on screen as they come in, until the view moves on
+            while (shown && atomic_load_i64(&g_view_generation) == generation &&
+                   !pool_wait_for(PREVIEW_PRESENT_MS))
+            {
+                mutex_lock(&shown->lock);
+                platform->present(platform, shown->pixels);
+                mutex_unlock(&shown->lock);
+            }
+            pool_wait();
+        }
+        free(recolor);
+        free(counted);
+
+        // the pieces come right after the tiles
+        u32 pieces_used = (u32)MIN(atomic_load_i64(&pieces.used), (int64_t)pieces.capacity);
+        u32 total_rendered = total_tiles + pieces_used;
+
+        // neither the stats nor the costs of half a frame mean much, keep the last ones
+        for (u32 i = 0; i < total_rendered; i++)
+        {
+            if (tiles[i].abandoned)
+            {
+                cache->valid = false;
+                free(frame_costs);
+                free(guessed);
+                free(layout);
+                free(order);
+                free(tiles);
+                return false;
+            }
+        }
+
+        stats.pieces += pieces_used;
+        for (u32 i = 0; i < total_rendered; i++) {
+            stats.escape.interior_skipped += tiles[i].stats.interior_skipped;
+            stats.escape.cycle_points += tiles[i].stats.cycle_points;
+            stats.escape.cycle_iterations_saved += tiles[i].stats.cycle_iterations_saved;
+            stats.escape.rebases += tiles[i].stats.rebases;
+            stats.escape.bla_iterations_skipped += tiles[i].stats.bla_iterations_skipped;
+            stats.filled += tiles[i].filled;
+            elapsed_ms[tiles[i].precision] += tiles[i].elapsed_ms;
+        }
+
+        // pieces add up into the tile they were split from
+        for (u32 i = 0; i < total_rendered; i++) {
+            frame_costs[tiles[i].index] += (float)tiles[i].elapsed_ms;
+        }
+
+        pool_worker_stats_t level[POOL_MAX_THREADS];
+        stats.workers = pool_worker_stats(level, POOL_MAX_THREADS);
+        for (int i = 0; i < stats.workers; i++) {
+            stats.worker[i].busy_ms += level[i].busy_ms;
+            stats.worker[i].idle_ms += level[i].idle_ms;
+            stats.worker[i].jobs += level[i].jobs;
+            stats.worker[i].steals += level[i].steals;
+        }
+
+        if (mirror)
+        {
+            PROFILE("Mirroring rows")
+            {
+                mirror_rows(platform, cache, conjugate_rows, mirror_start, mirror_end);
+            }
+        }
+
+        if (step > 1) {
+            platform->present(platform, platform->pixels);
+        }
+    }
+    cache->valid = true;
+
+    /*
+        The tiles went on screen with the last frame's distribution (or none), this
+        frame's can only be known now that all of it is in.
+     */
+    // the colouring the frame ends up in, the anti-aliasing averages with it too
+    coloring_t equalized = *coloring;
+    if (coloring->equalize && !accumulated)
+    {
+        PROFILE("Equalizing colours")
+        {
+            if (histogram) {
+                equalize_finish(cache);
+            }
+            equalized.equalize_cdf = g_equalize.cdf;
+
+            colorize_job_t *jobs = malloc(tiles_y * sizeof(colorize_job_t));
+            for (u32 y = 0; y < tiles_y; ++y)
+            {
+                jobs[y] = (colorize_job_t){
+                    .platform = platform,
+                    .smooth = cache->smooth,
+                    .coloring = &equalized,
+                    .start_x = 0, .end_x = width,
+                    .start_y = y * tile_size, .end_y = MIN(height, (y + 1) * tile_size)
+                };
+                pool_submit(colorize_rows, &jobs[y]);
+            }
+            pool_wait();
+            free(jobs);
+        }
+    }
+
+    // a still frame has no tiles to copy this from
+    tile_data_t base = {
+        .width = width, .height = height,
+        .platform = platform,
+        .max_iterations = max_iterations,
+        .center_x = center_x,
+        .center_y = center_y,
+        .scale = scale,
+        .deep = deep ? *deep : (deep_params_t){0},
+        .step = 1,
+        .counts = cache->counts,
+        .smooth = cache->smooth,
+        .coloring = coloring,
+        .generation = generation
+    };
+
+    bool complete = true;
+
+    if (accumulated)
+    {
+        PROFILE("Accumulating samples")
+        {
+            complete = accumulate_round(platform, cache, &base, &equalized, &stats);
+            memcpy(platform->pixels, cache->accum_pixels, width * height * sizeof(color_t));
+        }
+    }
+    else
+    {
+        if (still && cache->aa_samples > 0 && cache->aa_budget != cache->aa_samples)
+        {
+            PROFILE("Anti-aliasing")
+            {
+                complete = antialias_edges(platform, cache, &base, &stats);
+            }
+        }
+        else if (cache->aa_samples == 0)
+        {
+            cache->aa_count = 0;
+            cache->aa_budget = 0;
+        }
+
+        if (complete && cache->aa_count > 0) {
+            antialias_apply(platform, cache, &equalized);
+        }
+
+        // the rounds start with the next still frame
+        if (complete && still && cache->accum_samples > 0) {
+            accumulate_start(platform, cache, &equalized);
+        } else {
+            cache->accum_valid = false;
+        }
+    }
+    stats.antialiased = cache->aa_count;
+
+    if (!complete)
+    {
+        free(frame_costs);
+        free(guessed);
+        free(layout);
+        free(order);
+        free(tiles);
+        return false;
+    }
+
+    for (u32 i = 0; i < total_tiles; i++) {
+        stats.tiles[tiles[i].precision]++;
+    }
+    g_render_stats = stats;
+
+    // PROFILE is not thread safe, the tiles time themselves and get added up here
+    for (int p = 0; p < PRECISION_COUNT; p++) {
+        prof_record(g_tile_profile_labels[p], elapsed_ms[p], g_render_stats.tiles[p]);
+    }
+
+    if (full_grid)
+    {
+        memcpy(costs->cost, frame_costs, grid_tiles * sizeof(float));
+        costs->center_x = cache->center_x;
+        costs->center_y = cache->center_y;
+        costs->scale = cache->scale;
+        costs->valid = true;
+    }
+
+    double busy_ms = 0.0, idle_ms = 0.0;
+    u64 jobs = 0;
+    for (int i = 0; i < g_render_stats.workers; i++) {
+        busy_ms += g_render_stats.worker[i].busy_ms;
+        idle_ms += g_render_stats.worker[i].idle_ms;
+        jobs += g_render_stats.worker[i].jobs;
+    }
+    prof_record("Workers busy", busy_ms, jobs);
+    prof_record("Workers idle", idle_ms, g_render_stats.workers);
+
+    free(frame_costs);
+    free(guessed);
+    free(layout);
+    free(order);
+    free(tiles);
+    return true;
+}
+
+void render_mandelbrot_gpu(platform_api_t *platform, const coloring_t *coloring, double center_x, double center_y, 
+                           double scale, int max_iterations) 
+{
+    #ifdef USE_CUDA
+        // colours on the device with its own palette, nothing is kept to recolour from
+        (void) coloring;
+
+        uint64_t interior_skipped = 0;
+        cuda_render_mandelbrot(
+            (uint32_t *)platform->pixels,
+            platform->screen_width,
+            platform->screen_height,
+            center_x,
+            center_y,
+            scale,
+            max_iterations,
+            &interior_skipped
+        );
+
+        g_render_stats = (render_stats_t){ .pixels = (u64)platform->screen_width * platform->screen_height };
+        g_render_stats.escape.interior_skipped = interior_skipped;
+    #else
+        render_mandelbrot_parallel(platform, coloring, center_x, center_y, scale, max_iterations, NULL, false, 0);
+    #endif
+}
+
+void sync_view_center(app_state_t *state)
+{
+    state->view_center_x = hp_to_double(&state->view_center_hp_x, HP_MAX_LIMBS);
+    state->view_center_y = hp_to_double(&state->view_center_hp_y, HP_MAX_LIMBS);
+}
+
+/*
+    A double runs out around 1e-308, so past 2^-VIEW_SCALE_STEP the exponent is moved
+    over to view_scale_exp a step at a time and view_scale itself never gets near that.
+    Anything shallower keeps view_scale_exp at 0 and can keep using view_scale as is.
+    target_scale shares view_scale_exp and moves along with it.
+ */
+#define VIEW_SCALE_STEP 512
+
+void normalize_view_scale(app_state_t *state)
+{
+    double step = ldexp(1.0, VIEW_SCALE_STEP);
+
+    if (state->view_scale < 1.0 / step)
+    {
+        state->view_scale *= step;
+        state->target_scale *= step;
+        state->view_scale_exp -= VIEW_SCALE_STEP;
+    }
+    else if (state->view_scale_exp < 0 && state->view_scale >= 1.0)
+    {
+        state->view_scale /= step;
+        state->target_scale /= step;
+        state->view_scale_exp += VIEW_SCALE_STEP;
+    }
+}
+
+fe_t view_scale_fe(const app_state_t *state)
+{
+    return fe_make(state->view_scale, state->view_scale_exp);
+}
+
+/*
+    Scales the view by factor keeping the point under the mouse where it is, the
+    centre moves by the mouse offset times the change in scale (REANCHOR_VIEW relative
+    to the current centre), kept as floatexp since neither may fit in a double.
+ */
+void zoom_view(platform_api_t *platform, app_state_t *state, double factor)
+{
+    fe_t scale = view_scale_fe(state);
+    fe_t shift_x = fe_mul_double(scale, (platform->mouse_x - platform->screen_width / 2.0) * (1.0 - factor));
+    fe_t shift_y = fe_mul_double(scale, (platform->mouse_y - platform->screen_height / 2.0) * (1.0 - factor));
+
+    state->view_scale *= factor;
+    normalize_view_scale(state);
+
+    hp_add_fe(&state->view_center_hp_x, &state->view_center_hp_x, shift_x, HP_MAX_LIMBS);
+    hp_add_fe(&state->view_center_hp_y, &state->view_center_hp_y, shift_y, HP_MAX_LIMBS);
+    sync_view_center(state);
+}
+
+/*
+    The wheel moves target_scale and the view follows it over a few frames, covering
+    the same fraction of what is left (in log scale) every ZOOM_TIME seconds.
+    Every step is previewed from the frame before, so the zoom looks continuous
+    however long the real frames take.
+ */
+#define ZOOM_TIME 0.08
+#define ZOOM_SNAP 1e-3      // close enough in log scale, the view lands on the target exactly
+
+void animate_zoom(platform_api_t *platform, app_state_t *state)
+{
+    if (state->target_scale == state->view_scale)
+        return;
+
+    double remaining = log(state->target_scale / state->view_scale);
+    double step = remaining * (1.0 - exp(-platform->dt / ZOOM_TIME));
+
+    if (fabs(remaining - step) < ZOOM_SNAP)
+    {
+        zoom_view(platform, state, state->target_scale / state->view_scale);
+        state->view_scale = state->target_scale;
+    }
+    else
+    {
+        zoom_view(platform, state, exp(step));
+    }
+}
+
+/*
+    The mandelbrot set is symmetric about the real axis: row y shows the conjugates of
+    row height - y - 2 * center_y / scale. When that comes out a whole number of rows,
+    to within MIRROR_TOLERANCE of a pixel, half of whatever straddles the axis can be
+    copied from the other half. Returns the sum of the two rows, 0 when it doesn't work out.
+    Goes by the exact centre, deep zooms along the axis mirror as well.
+ */
+#define MIRROR_TOLERANCE 1e-3
+
+u32 view_conjugate_rows(platform_api_t *platform, const app_state_t *state)
+{
+    fe_t offset = fe_div(hp_to_fe(&state->view_center_hp_y, HP_MAX_LIMBS), view_scale_fe(state));
+
+    // way off the axis, the screen is nowhere near it
+    if (fe_log2(offset) > 30.0)
+        return 0;
+
+    double sum = platform->screen_height - 2.0 * fe_to_double(offset);
+    double whole = round(sum);
+
+    if (fabs(sum - whole) > MIRROR_TOLERANCE || whole < 2.0 || whole > 2.0 * platform->screen_height - 2.0)
+        return 0;
+
+    return (u32)whole;
+}
+
+void tile_costs_predict(platform_api_t *platform, app_state_t *state)
+{
+    tile_cost_map_t *map = &g_tile_costs;
+
+    u32 width = platform->screen_width;
+    u32 height = platform->screen_height;
+    u32 tiles_x = CEIL_DIV(width, TILE_SIZE);
+    u32 tiles_y = CEIL_DIV(height, TILE_SIZE);
+
+    if (map->width != width || map->height != height || map->max_iterations != state->max_iterations)
+    {
+        free(map->cost);
+        free(map->predicted);
+        map->cost = calloc(tiles_x * tiles_y, sizeof(float));
+        map->predicted = calloc(tiles_x * tiles_y, sizeof(float));
+        map->tiles_x = tiles_x;
+        map->tiles_y = tiles_y;
+        map->width = width;
+        map->height = height;
+        map->max_iterations = state->max_iterations;
+        map->valid = false;
+    }
+
+    fe_t scale = view_scale_fe(state);
+    map->have_prediction = map->valid;
+
+    if (map->valid)
+    {
+        // old pixel = new pixel * ratio + shift, both relative to the screen centre
+        hp_t diff;
+        hp_sub(&diff, &state->view_center_hp_x, &map->center_x, HP_MAX_LIMBS);
+        double shift_x = fe_to_double(fe_div(hp_to_fe(&diff, HP_MAX_LIMBS), map->scale));
+        hp_sub(&diff, &state->view_center_hp_y, &map->center_y, HP_MAX_LIMBS);
+        double shift_y = fe_to_double(fe_div(hp_to_fe(&diff, HP_MAX_LIMBS), map->scale));
+        double ratio = fe_to_double(fe_div(scale, map->scale));
+
+        float most = 0.0f;
+        for (u32 i = 0; i < tiles_x * tiles_y; ++i) {
+            most = MAX(most, map->cost[i]);
+        }
+
+        for (u32 ty = 0; ty < tiles_y; ++ty)
+        {
+            for (u32 tx = 0; tx < tiles_x; ++tx)
+            {
+                // edge tiles are cut short by the screen
+                double mid_x = 0.5 * (tx * TILE_SIZE + MIN(width, (tx + 1) * TILE_SIZE));
+                double mid_y = 0.5 * (ty * TILE_SIZE + MIN(height, (ty + 1) * TILE_SIZE));
+
+                double x = (mid_x - width / 2.0) * ratio + shift_x + width / 2.0;
+                double y = (mid_y - height / 2.0) * ratio + shift_y + height / 2.0;
+
+                float cost = most;
+                if (x >= 0.0 && y >= 0.0 && x < width && y < height) {
+                    cost = map->cost[(u32)(y / TILE_SIZE) * tiles_x + (u32)(x / TILE_SIZE)];
+                }
+                map->predicted[ty * tiles_x + tx] = cost;
+            }
+        }
+    }
+}
+
+// pixel i of the new view sits on pixel (i - size / 2) * ratio + shift + size / 2 of the old one
+static void resample_axis(int *from, u32 size, double ratio, double shift)
+{
+    for (u32 i = 0; i < size; ++i)
+    {
+        double old = floor((i - size / 2.0) * ratio + shift + size / 2.0 + 0.5);
+        from[i] = (old >= 0.0 && old < size) ? (int)old : -1;
+    }
+}
+
+void frame_cache_prepare(platform_api_t *platform, app_state_t *state, int mode)
+{
+    frame_cache_t *cache = &g_frame_cache;
+
+    u32 width = platform->screen_width;
+    u32 height = platform->screen_height;
+
+    // nothing to go on, the gpu does not fill the counts either
+    bool fresh = mode == FRAME_CACHE_NONE;
+
+    if (cache->width != width || cache->height != height)
+    {
+        free(cache->counts);
+        free(cache->smooth);
+        free(cache->scratch);
+        free(cache->smooth_scratch);
+        free(cache->accum_sum);
+        free(cache->accum_count);
+        free(cache->accum_stable);
+        free(cache->accum_pixels);
+        cache->counts = malloc(width * height * sizeof(int));
+        cache->smooth = malloc(width * height * sizeof(float));
+        cache->scratch = malloc(width * height * sizeof(int));
+        cache->smooth_scratch = malloc(width * height * sizeof(float));
+        cache->accum_sum = malloc(width * height * 3 * sizeof(float));
+        cache->accum_count = malloc(width * height * sizeof(u16));
+        cache->accum_stable = malloc(width * height * sizeof(u8));
+        cache->accum_pixels = malloc(width * height * sizeof(color_t));
+        cache->width = width;
+        cache->height = height;
+        cache->valid = false;
+        fresh = true;
+    }
+
+    fe_t scale = view_scale_fe(state);
+    cache->reuse = false;
+    cache->preview = false;
+
+    // in old pixels
+    hp_t diff;
+    hp_sub(&diff, &state->view_center_hp_x, &cache->center_x, HP_MAX_LIMBS);
+    double shift_x = fe_to_double(fe_div(hp_to_fe(&diff, HP_MAX_LIMBS), cache->scale));
+    hp_sub(&diff, &state->view_center_hp_y, &cache->center_y, HP_MAX_LIMBS);
+    double shift_y = fe_to_double(fe_div(hp_to_fe(&diff, HP_MAX_LIMBS), cache->scale));
+
+    if (!fresh && cache->valid && cache->mode == mode &&
+        cache->max_iterations == state->max_iterations &&
+        cache->scale.m == scale.m && cache->scale.e == scale.e)
+    {
+        // a pan moves by whole pixels, anything in between is not a shifted copy
+        double whole_x = round(shift_x);
+        double whole_y = round(shift_y);
+
+        if (fabs(shift_x - whole_x) < 1e-6 && fabs(shift_y - whole_y) < 1e-6 &&
+            fabs(whole_x) < width && fabs(whole_y) < height)
+        {
+            int sx = (int)whole_x;
+            int sy = (int)whole_y;
+
+            u32 x0 = (u32)MAX(0, -sx);
+            u32 x1 = (u32)MIN((int)width, (int)width - sx);
+            u32 y0 = (u32)MAX(0, -sy);
+            u32 y1 = (u32)MIN((int)height, (int)height - sy);
+
+            // rows move towards where they are read from first, so nothing is overwritten early
+            for (u32 i = 0; i < y1 - y0; ++i)
+            {
+                u32 y = sy >= 0 ? y0 + i : y1 - 1 - i;
+                memmove(&cache->counts[y * width + x0], &cache->counts[(y + sy) * width + x0 + sx], (x1 - x0) * sizeof(int));
+                memmove(&cache->smooth[y * width + x0], &cache->smooth[(y + sy) * width + x0 + sx], (x1 - x0) * sizeof(float));
+            }
+
+            // the strips that came into view
+            for (u32 y = 0; y < height; ++y) {
+                for (u32 x = 0; x < width; ++x) {
+                    if (y < y0 || y >= y1 || x < x0 || x >= x1) {
+                        cache->counts[y * width + x] = FRAME_COUNT_UNKNOWN;
+                        cache->smooth[y * width + x] = SMOOTH_UNKNOWN;
+                    }
+                }
+            }
+
+            cache->reuse = true;
+            cache->shift_x = sx;
+            cache->shift_y = sy;
+        }
+    }
+
+    if (fresh)
+    {
+        for (u32 i = 0; i < width * height; ++i) {
+            cache->counts[i] = FRAME_COUNT_UNKNOWN;
+            cache->smooth[i] = SMOOTH_UNKNOWN;
+        }
+    }
+    else if (!cache->reuse)
+    {
+        int *from_x = malloc(width * sizeof(int));
+        int *from_y = malloc(height * sizeof(int));
+        double ratio = fe_to_double(fe_div(scale, cache->scale));
+
+        resample_axis(from_x, width, ratio, shift_x);
+        resample_axis(from_y, height, ratio, shift_y);
+
+        int max_iterations = state->max_iterations;
+
+        for (u32 y = 0; y < height; ++y)
+        {
+            int *row = &cache->scratch[y * width];
+            float *smooth_row = &cache->smooth_scratch[y * width];
+            u32 old_row = from_y[y] >= 0 ? from_y[y] * width : 0;
+
+            for (u32 x = 0; x < width; ++x)
+            {
+                int count = FRAME_COUNT_UNKNOWN;
+                float smooth = SMOOTH_UNKNOWN;
+                if (from_y[y] >= 0 && from_x[x] >= 0) {
+                    count = cache->counts[old_row + from_x[x]];
+                    smooth = cache->smooth[old_row + from_x[x]];
+                }
+
+                // inside under the old cap stays inside under the new one
+                if (count >= cache->max_iterations || count > max_iterations) {
+                    count = max_iterations;
+                    smooth = SMOOTH_INSIDE;
+                }
+                row[x] = count;
+                smooth_row[x] = smooth;
+            }
+        }
+
+        free(from_x);
+        free(from_y);
+
+        int *counts = cache->counts;
+        cache->counts = cache->scratch;
+        cache->scratch = counts;
+
+        float *smooth = cache->smooth;
+        cache->smooth = cache->smooth_scratch;
+        cache->smooth_scratch = smooth;
+        cache->preview = true;
+    }
+
+    // the extra samples only stay while every pixel does
+    if (!cache->reuse || cache->shift_x != 0 || cache->shift_y != 0)
+    {
+        cache->aa_count = 0;
+        cache->aa_budget = 0;
+        cache->accum_valid = false;
+        cache->counts_version++;
+    }
+    cache->aa_samples = (u32)MAX(0, state->aa_samples);
+    cache->accum_samples = (u32)MAX(0, MIN(UINT16_MAX, state->accumulate_samples));
+
+    cache->mode = mode;
+    cache->max_iterations = state->max_iterations;
+    cache->center_x = state->view_center_hp_x;
+    cache->center_y = state->view_center_hp_y;
+    cache->scale = scale;
+
+    // until this frame is finished
+    cache->valid = false;
+}
+
+/*
+    Puts the resampled counts on screen right away, the frame itself can take a
+    while and until it is done this is all there is to show for the new view.
+ */
+void frame_cache_show_preview(platform_api_t *platform, const coloring_t *coloring)
+{
+    frame_cache_t *cache = &g_frame_cache;
+    if (!cache->preview || !platform->present)
+        return;
+
+    u32 bands = CEIL_DIV(platform->screen_height, TILE_SIZE);
+    colorize_job_t *jobs = malloc(bands * sizeof(colorize_job_t));
+
+    for (u32 i = 0; i < bands; ++i)
+    {
+        jobs[i] = (colorize_job_t){
+            .platform = platform,
+            .smooth = cache->smooth,
+            .coloring = coloring,
+            .start_x = 0, .end_x = platform->screen_width,
+            .start_y = i * TILE_SIZE, .end_y = MIN(platform->screen_height, (i + 1) * TILE_SIZE)
+        };
+        pool_submit(colorize_rows, &jobs[i]);
+    }
+    pool_wait();
+    free(jobs);
+
+    platform->present(platform, platform->pixels);
+}
+
+/*
+    The reference is kept for as long as the view stays close to it, panning at the
+    same depth then only changes the offset added to every pixel's dc.
+    It is recomputed when it falls off screen, needs more limbs or the iteration cap changes.
+ */
+const ref_orbit_t *update_reference_orbit(platform_api_t *platform, app_state_t *state, int max_iterations,
+                                          fe_t *offset_x, fe_t *offset_y)
+{
+    fe_t scale = view_scale_fe(state);
+    int limbs = hp_limbs_for_scale(scale);
+    fe_t reach = fe_mul_double(scale, MAX(platform->screen_width, platform->screen_height));
+
+    fe_t dx = fe_from_double(0.0);
+    fe_t dy = fe_from_double(0.0);
+
+    if (g_ref_orbit.z_re)
+    {
+        hp_t diff;
+        hp_sub(&diff, &state->view_center_hp_x, &g_ref_orbit.c_re, HP_MAX_LIMBS);
+        dx = hp_to_fe(&diff, HP_MAX_LIMBS);
+        hp_sub(&diff, &state->view_center_hp_y, &g_ref_orbit.c_im, HP_MAX_LIMBS);
+        dy = hp_to_fe(&diff, HP_MAX_LIMBS);
+    }
+
+    bool stale = !g_ref_orbit.z_re ||
+                 g_ref_orbit.max_iterations != max_iterations ||
+                 g_ref_orbit.limbs < limbs ||
+                 fe_less_abs(reach, dx) || fe_less_abs(reach, dy);
+
+    if (stale)
+    {
+        PROFILE("Reference orbit")
+        {
+            ref_orbit_compute(&g_ref_orbit, &state->view_center_hp_x, &state->view_center_hp_y, limbs, max_iterations);
+        }
+        g_bla_table.orbit = NULL;
+        dx = fe_from_double(0.0);
+        dy = fe_from_double(0.0);
+    }
+
+    *offset_x = dx;
+    *offset_y = dy;
+    return &g_ref_orbit;
+}
+
+/*
+    Radii in the table depend on how far a pixel can be from the reference, build it
+    for the furthest a pixel gets before the reference is recomputed so panning
+    does not need a rebuild, zooming out past that does.
+    Zooming in keeps the old table valid, just overly careful, rebuild once it is
+    a few times more careful than needed.
+ */
+const bla_table_t *update_bla_table(platform_api_t *platform, app_state_t *state, const ref_orbit_t *ref)
+{
+    double w = platform->screen_width;
+    double h = platform->screen_height;
+    double dc_max = fe_to_double(fe_mul_double(view_scale_fe(state), MAX(w, h) + 0.5 * sqrt(w*w + h*h)));
+
+    bool stale = g_bla_table.orbit != ref ||
+                 g_bla_table.orbit_length != ref->length ||
+                 g_bla_table.dc_max < dc_max ||
+                 g_bla_table.dc_max > 4.0 * dc_max;
+
+    if (stale)
+    {
+        PROFILE("BLA table")
+        {
+            bla_build(&g_bla_table, ref, dc_max);
+        }
+    }
+
+    return &g_bla_table;
+}
+
+EXPORT void app_init(platform_api_t *platform, app_state_t *state) 
+{
+    (void) platform;
+
+    state->initialized = true;
+    state->animation_time = 0.0f;
+    state->frame_count = 0;
+
+    state->view_center_x = -0.637011;
+    state->view_center_y = -0.0395159;
+    state->view_scale = 0.002;
+    state->view_scale_exp = 0;
+    state->target_scale = 0.002;
+
+    hp_from_double(&state->view_center_hp_x, state->view_center_x);
+    hp_from_double(&state->view_center_hp_y, state->view_center_y);
+
+    state->is_panning = false;
+    state->pan_start_x = 0;
+    state->pan_start_y = 0;
+    state->pan_start_center_x = 0.0;
+    state->pan_start_center_y = 0.0;
+
+    state->last_mouse_x = 0;
+    state->last_mouse_y = 0;
+
+    state->show_stats = false;
+
+    state->max_iterations = 1024;
+    state->use_bla = true;
+    state->use_direct_hp = false;
+    state->use_subdivision = true;
+    state->aa_samples = AA_SAMPLES_FIRST * 4;
+    state->accumulate_samples = ACCUM_SAMPLES_DEFAULT;
+
+    state->palette = COLOR_BLUE;
+    state->palette_density = 1.0f;
+    state->palette_offset = 0.0f;
+    state->cycle_palette = false;
+    state->equalize_colors = false;
+
+    prof_init();
+
+    kernels_init();
+
+    pool_start(0);
+    printf("[CPU] %d worker threads\n", pool_thread_count());
+    mutex_init(&g_preview_screen.lock);
+
+    simple_font = init_simple_font((u32*)font_pixels);
+
+    for (int i = 0; i < 512; ++i){
+        color_map[i] = rgb_from_wavelength(380.0 + (i * 400.0 / 512));
+    }
+
+    #ifdef USE_CUDA
+        if (cuda_is_available()) 
+        {
+            printf("[GPU] CUDA is available!\n");
+            cuda_print_info();
+            cuda_init(1920,1080);
+            state->use_gpu = true;
+        } 
+        else 
+        {
+            printf("[GPU] CUDA not available, using CPU fallback\n");
+            state->use_gpu = false;
+        }
+    #else
+        state->use_gpu = false;
+        printf("[GPU] Not compiled with CUDA support\n");
+    #endif
+
+
+    printf("[APP] Initialized!\n");
+}
 
 EXPORT void app_update(platform_api_t *platform, app_state_t *state) 
 {
     state->animation_time += (float) platform->dt;
     state->frame_count++;
+
+    // to tell whether anything below moved the view
+    hp_t last_center_x = state->view_center_hp_x;
+    hp_t last_center_y = state->view_center_hp_y;
+    double last_scale = state->view_scale;
+    int64_t last_scale_exp = state->view_scale_exp;
+    int last_max_iterations = state->max_iterations;
     
     if (platform->keys_pressed[256]) { 
         platform->should_quit = true;
@@ -657,16 +3223,11 @@ EXPORT void app_update(platform_api_t *platform, app_state_t *state)
     if (platform->scroll_y != 0) 
     {
         double zoom_factor = 1.0 + (platform->scroll_y * 0.1);
-
-        double mouse_cx = SCREEN_TO_COMPLEX(platform->mouse_x, state->view_center_x, platform->screen_width, state->view_scale);
-        double mouse_cy = SCREEN_TO_COMPLEX(platform->mouse_y, state->view_center_y, platform->screen_height, state->view_scale);
-        
-        state->view_scale *= zoom_factor;
-
-        state->view_center_x = REANCHOR_VIEW(mouse_cx, platform->mouse_x, platform->screen_width, state->view_scale);
-        state->view_center_y = REANCHOR_VIEW(mouse_cy, platform->mouse_y, platform->screen_height, state->view_scale);
+        state->target_scale *= zoom_factor;
     }
 
+    animate_zoom(platform, state);
+
     bool pan_button = platform->right_button_down;
 
     if (pan_button && !state->is_panning) 
@@ -676,6 +3237,8 @@ EXPORT void app_update(platform_api_t *platform, app_state_t *state)
         state->pan_start_y = platform->mouse_y;
         state->pan_start_center_x = state->view_center_x;
         state->pan_start_center_y = state->view_center_y;
+        state->pan_start_center_hp_x = state->view_center_hp_x;
+        state->pan_start_center_hp_y = state->view_center_hp_y;
     } 
     else if (!pan_button && state->is_panning) 
     {
@@ -687,15 +3250,94 @@ EXPORT void app_update(platform_api_t *platform, app_state_t *state)
         int dx = platform->mouse_x - state->pan_start_x;
         int dy = platform->mouse_y - state->pan_start_y;
         
-        state->view_center_x = state->pan_start_center_x - dx * state->view_scale;
-        state->view_center_y = state->pan_start_center_y - dy * state->view_scale;
+        fe_t scale = view_scale_fe(state);
+        hp_add_fe(&state->view_center_hp_x, &state->pan_start_center_hp_x, fe_mul_double(scale, -dx), HP_MAX_LIMBS);
+        hp_add_fe(&state->view_center_hp_y, &state->pan_start_center_hp_y, fe_mul_double(scale, -dy), HP_MAX_LIMBS);
+        sync_view_center(state);
     }
 
     if (platform->keys_pressed['R']) {
         state->view_center_x = -0.637011;
         state->view_center_y = -0.0395159;
         state->view_scale = 0.002;
+        state->view_scale_exp = 0;
         state->target_scale = 0.002;
+        hp_from_double(&state->view_center_hp_x, state->view_center_x);
+        hp_from_double(&state->view_center_hp_y, state->view_center_y);
+    }
+
+    if (platform->keys_pressed['I']) {
+        state->show_stats = !state->show_stats;
+    }
+
+    // keep averaging more samples into a still view or not
+    if (platform->keys_pressed['T']) {
+        state->accumulate_samples = state->accumulate_samples ? 0 : ACCUM_SAMPLES_DEFAULT;
+        printf("Accumulation: %d samples per pixel\n", state->accumulate_samples);
+    }
+
+    // the cap on the extra edge samples of a still frame, x4 each press and then off
+    if (platform->keys_pressed['A']) {
+        state->aa_samples = state->aa_samples == 0 ? AA_SAMPLES_FIRST :
+                            state->aa_samples < AA_SAMPLES_LIMIT ? state->aa_samples * 4 : 0;
+        printf("Anti-aliasing: %d samples per frame\n", state->aa_samples);
+    }
+
+    if (platform->keys_pressed['H']) {
+        state->use_direct_hp = !state->use_direct_hp;
+        printf("Direct high precision rendering %s\n", state->use_direct_hp ? "on" : "off");
+    }
+
+    if (platform->keys_pressed['B']) {
+        state->use_bla = !state->use_bla;
+        printf("Linear approximation %s\n", state->use_bla ? "on" : "off");
+    }
+
+    if (platform->keys_pressed['M']) {
+        state->use_subdivision = !state->use_subdivision;
+        printf("Rectangle subdivision %s\n", state->use_subdivision ? "on" : "off");
+    }
+
+    if (platform->keys_pressed['C']) {
+        state->palette = (state->palette + 1) % COLOR_PALETTE_COUNT;
+        printf("Palette: %s\n", g_palette_names[state->palette]);
+    }
+
+    if (platform->keys_pressed['P']) {
+        state->cycle_palette = !state->cycle_palette;
+    }
+
+    // deep views put most pixels in a narrow range of counts, equalizing spreads them over the palette
+    if (platform->keys_pressed['E']) {
+        state->equalize_colors = !state->equalize_colors;
+        printf("Histogram equalization %s\n", state->equalize_colors ? "on" : "off");
+    }
+
+    // how stretched the palette is, in powers of two
+    if (platform->keys_pressed['.'] && state->palette_density < PALETTE_DENSITY_LIMIT) {
+        state->palette_density *= 2.0f;
+        printf("Palette density: %g\n", state->palette_density);
+    }
+
+    if (platform->keys_pressed[','] && state->palette_density > 1.0f / PALETTE_DENSITY_LIMIT) {
+        state->palette_density /= 2.0f;
+        printf("Palette density: %g\n", state->palette_density);
+    }
+
+    if (state->cycle_palette) {
+        state->palette_offset += (float)platform->dt / PALETTE_CYCLE_TIME;
+        state->palette_offset -= floorf(state->palette_offset);
+    }
+
+    // deep views need far more iterations than the default to resolve anything
+    if (platform->keys_pressed[']'] && state->max_iterations < MAX_ITERATIONS_LIMIT) {
+        state->max_iterations *= 2;
+        printf("Max iterations: %d\n", state->max_iterations);
+    }
+
+    if (platform->keys_pressed['['] && state->max_iterations > MIN_ITERATIONS_LIMIT) {
+        state->max_iterations /= 2;
+        printf("Max iterations: %d\n", state->max_iterations);
     }
 
     if (platform->keys_pressed['G']) 
@@ -710,38 +3352,133 @@ EXPORT void app_update(platform_api_t *platform, app_state_t *state)
 
     state->last_mouse_x = platform->mouse_x;
     state->last_mouse_y = platform->mouse_y;
+
+    if (memcmp(&last_center_x, &state->view_center_hp_x, sizeof(hp_t)) != 0 ||
+        memcmp(&last_center_y, &state->view_center_hp_y, sizeof(hp_t)) != 0 ||
+        last_scale != state->view_scale || last_scale_exp != state->view_scale_exp ||
+        last_max_iterations != state->max_iterations)
+    {
+        state->view_generation = atomic_add_i64(&g_view_generation, 1);
+    }
 }
 
 EXPORT void app_render(platform_api_t *platform, app_state_t *state) 
 {
     float t = state->animation_time;
 
-    double current_scale = state->view_scale;           
+    g_frame_generation = state->view_generation;
+    bool complete = true;
+
+    fe_t scale_fe = view_scale_fe(state);
+    double current_scale = fe_to_double(scale_fe);      // 0 once past what a double holds           
     double current_center_x = state->view_center_x;
     double current_center_y = state->view_center_y;
-    int max_iterations = 1024;
+    int max_iterations = state->max_iterations;
+
+    coloring_t coloring = make_coloring((color_palette_t)state->palette, max_iterations, state->palette_density, state->palette_offset);
+    coloring.equalize = state->equalize_colors;
+    if (coloring.equalize && g_equalize.max_iterations == max_iterations) {
+        coloring.equalize_cdf = g_equalize.cdf;
+    }
+
+    // what the tiles furthest out will need, past a double only the cpu paths go further
+    double half_diagonal = 0.5 * sqrt((double)platform->screen_width * platform->screen_width +
+                                      (double)platform->screen_height * platform->screen_height) * current_scale;
+    precision_t frame_precision = precision_for_spacing(current_scale, MAX(fabs(current_center_x), fabs(current_center_y)) + half_diagonal);
+
+    #ifdef USE_CUDA
+        bool deep_zoom = frame_precision > PRECISION_DOUBLE;
+    #endif
+    bool perturbation = current_scale < DEEP_ZOOM_SCALE;
+    bool extended = current_scale < EXTENDED_SCALE;
     
     clear_screen(platform);
 
+    tile_costs_predict(platform, state);
+
+    int cache_mode = state->use_direct_hp ? FRAME_CACHE_DIRECT_HP :
+                     perturbation ? FRAME_CACHE_PERTURBATION | (state->use_bla ? FRAME_CACHE_BLA : 0) :
+                     FRAME_CACHE_CPU;
+    if (state->use_subdivision) {
+        cache_mode |= FRAME_CACHE_SUBDIVISION;
+    }
+    #ifdef USE_CUDA
+        if (!state->use_direct_hp && state->use_gpu && !deep_zoom) {
+            cache_mode = FRAME_CACHE_NONE;
+        }
+    #endif
+    frame_cache_prepare(platform, state, cache_mode);
+    frame_cache_show_preview(platform, &coloring);
+
+    u32 conjugate_rows = view_conjugate_rows(platform, state);
+
+    if (state->use_direct_hp)
+    {
+        // ground truth for the paths below, every pixel at full precision
+        PROFILE("mandelbrot_direct_hp")
+        {
+            deep_params_t deep = {
+                .scale_fe = scale_fe,
+                .center_hp_x = &state->view_center_hp_x,
+                .center_hp_y = &state->view_center_hp_y,
+                .limbs = hp_limbs_for_scale(scale_fe)
+            };
+
+            complete = render_mandelbrot_parallel(platform, &coloring, current_center_x, current_center_y,
+                                                  current_scale, max_iterations, &deep, state->use_subdivision, conjugate_rows);
+        }
+    }
+    else
     #ifdef USE_CUDA
-        if (state->use_gpu) 
+        if (state->use_gpu && !deep_zoom) 
         {
             PROFILE("mandelbrot_gpu") 
             {
-                render_mandelbrot_gpu(platform, current_center_x, current_center_y, 
+                render_mandelbrot_gpu(platform, &coloring, current_center_x, current_center_y, 
                                     current_scale, max_iterations);
             }
         } 
         else
     #endif
+        if (perturbation)
+        {
+            PROFILE("mandelbrot_deep") 
+            {
+                deep_params_t deep = { .extended = extended, .scale_fe = scale_fe };
+                deep.ref = update_reference_orbit(platform, state, max_iterations, &deep.ref_offset_fe_x, &deep.ref_offset_fe_y);
+                deep.ref_offset_x = fe_to_double(deep.ref_offset_fe_x);
+                deep.ref_offset_y = fe_to_double(deep.ref_offset_fe_y);
+                deep.bla = state->use_bla ? update_bla_table(platform, state, deep.ref) : NULL;
+
+                complete = render_mandelbrot_parallel(platform, &coloring, current_center_x, current_center_y,
+                                                      current_scale, max_iterations, &deep, state->use_subdivision, conjugate_rows);
+            }
+        }
+        else
         {
             PROFILE("mandelbrot_cpu") 
             {
-                render_mandelbrot_parallel(platform, current_center_x, current_center_y, 
-                                        current_scale, max_iterations);
+                hp_t rest;
+                deep_params_t deep = {0};
+
+                // the part of the exact centre the double view_center_x/y lost, for double-double tiles
+                hp_add_double(&rest, &state->view_center_hp_x, -current_center_x, HP_MAX_LIMBS);
+                deep.center_lo_x = hp_to_double(&rest, HP_MAX_LIMBS);
+                hp_add_double(&rest, &state->view_center_hp_y, -current_center_y, HP_MAX_LIMBS);
+                deep.center_lo_y = hp_to_double(&rest, HP_MAX_LIMBS);
+
+                complete = render_mandelbrot_parallel(platform, &coloring, current_center_x, current_center_y,
+                                                      current_scale, max_iterations, &deep, state->use_subdivision, conjugate_rows);
             }
         }
 
+    // the view moved on while this one was being drawn, not worth showing
+    if (!complete)
+    {
+        platform->frame_incomplete = true;
+        return;
+    }
+
     double mouse_cx = SCREEN_TO_COMPLEX(platform->mouse_x, current_center_x, platform->screen_width, current_scale);
     double mouse_cy = SCREEN_TO_COMPLEX(platform->mouse_y, current_center_y, platform->screen_height, current_scale);
 
@@ -769,7 +3506,7 @@ EXPORT void app_render(platform_api_t *platform, app_state_t *state)
     int julia_y = 10;  
     
     PROFILE("julia_set") {
-        // render_julia_set(platform, mouse_cx, mouse_cy, julia_x, julia_y, julia_width, julia_height, 64);
+        // render_julia_set(platform, &coloring, mouse_cx, mouse_cy, julia_x, julia_y, julia_width, julia_height, 64);
     }
 
     static char time_text[64];
@@ -799,10 +3536,20 @@ EXPORT void app_render(platform_api_t *platform, app_state_t *state)
 
     static char backend_text[32];
     #ifdef USE_CUDA
-        snprintf(backend_text, sizeof(backend_text), "%s", state->use_gpu ? "GPU" : "CPU");
+        if (state->use_gpu) {
+            snprintf(backend_text, sizeof(backend_text), "GPU");
+        } else {
+            snprintf(backend_text, sizeof(backend_text), "CPU %s", g_kernels.name);
+        }
     #else
-        snprintf(backend_text, sizeof(backend_text), "CPU");
+        snprintf(backend_text, sizeof(backend_text), "CPU %s", g_kernels.name);
     #endif
+    if (state->use_direct_hp) {
+        snprintf(backend_text, sizeof(backend_text), "CPU hp %d limbs", hp_limbs_for_scale(scale_fe));
+    } else if (perturbation || !state->use_gpu) {
+        snprintf(backend_text, sizeof(backend_text), "CPU %s %s", g_kernels.name,
+                 precision_name(extended ? PRECISION_EXTENDED : perturbation ? PRECISION_PERTURBATION : frame_precision));
+    }
     rendered_text_t backend = {
         .font = simple_font,  
         .string = backend_text,
@@ -813,6 +3560,75 @@ EXPORT void app_render(platform_api_t *platform, app_state_t *state)
     };
     render_text(platform, &backend);
 
+    if (state->show_stats)
+    {
+        static char stats_text[1024];
+        double pixels = (double)MAX(g_render_stats.pixels, 1);
+        int len = snprintf(stats_text, sizeof(stats_text), "interior: %llu px (%.1f%%)\nperiodic: %llu px, %llu iterations saved",
+                           (unsigned long long)g_render_stats.escape.interior_skipped,
+                           100.0 * g_render_stats.escape.interior_skipped / pixels,
+                           (unsigned long long)g_render_stats.escape.cycle_points,
+                           (unsigned long long)g_render_stats.escape.cycle_iterations_saved);
+        if (state->use_subdivision) {
+            len += snprintf(stats_text + len, sizeof(stats_text) - len, "\nsubdivision: %llu px filled (%.1f%%)",
+                            (unsigned long long)g_render_stats.filled, 100.0 * g_render_stats.filled / pixels);
+        }
+        if (g_render_stats.reused) {
+            len += snprintf(stats_text + len, sizeof(stats_text) - len, "\nreused: %llu px (%.1f%%)",
+                            (unsigned long long)g_render_stats.reused, 100.0 * g_render_stats.reused / pixels);
+        }
+        if (g_render_stats.mirrored) {
+            len += snprintf(stats_text + len, sizeof(stats_text) - len, "\nmirrored: %llu px (%.1f%%)",
+                            (unsigned long long)g_render_stats.mirrored, 100.0 * g_render_stats.mirrored / pixels);
+        }
+        if (g_render_stats.accum_round) {
+            len += snprintf(stats_text + len, sizeof(stats_text) - len, "\naccumulation: round %u, %llu px sampled this frame",
+                            g_render_stats.accum_round, (unsigned long long)g_render_stats.accumulated);
+        }
+        if (g_render_stats.antialiased) {
+            len += snprintf(stats_text + len, sizeof(stats_text) - len, "\nantialiased: %llu px, %llu samples this frame",
+                            (unsigned long long)g_render_stats.antialiased, (unsigned long long)g_render_stats.aa_samples);
+        }
+        len += snprintf(stats_text + len, sizeof(stats_text) - len, "\ntiles:");
+        for (int p = 0; p < PRECISION_COUNT; ++p) {
+            if (g_render_stats.tiles[p]) {
+                len += snprintf(stats_text + len, sizeof(stats_text) - len, " %s %u", precision_name((precision_t)p), g_render_stats.tiles[p]);
+            }
+        }
+        if (g_render_stats.workers > 0) {
+            len += snprintf(stats_text + len, sizeof(stats_text) - len, "\nworkers busy/idle ms, %u pieces split:", g_render_stats.pieces);
+            for (int i = 0; i < MIN(g_render_stats.workers, 32); ++i) {
+                len += snprintf(stats_text + len, sizeof(stats_text) - len, "%s %.1f/%.1f", (i % 8 == 0) ? "\n " : "",
+                                g_render_stats.worker[i].busy_ms, g_render_stats.worker[i].idle_ms);
+            }
+            if (g_render_stats.workers > 32) {
+                len += snprintf(stats_text + len, sizeof(stats_text) - len, " ...");
+            }
+        }
+        if (perturbation) {
+            len += snprintf(stats_text + len, sizeof(stats_text) - len, "\nreference: %d iterations, %d limbs, %llu rebases",
+                            g_ref_orbit.length, g_ref_orbit.limbs, (unsigned long long)g_render_stats.escape.rebases);
+            snprintf(stats_text + len, sizeof(stats_text) - len, "\nBLA %s: %llu iterations skipped, %d levels",
+                     state->use_bla ? "on" : "off", (unsigned long long)g_render_stats.escape.bla_iterations_skipped,
+                     state->use_bla ? g_bla_table.levels : 0);
+        }
+        // grows up from the bottom edge
+        int lines = 1;
+        for (const char *c = stats_text; *c; ++c) {
+            lines += *c == '\n';
+        }
+
+        rendered_text_t stats = {
+            .font = simple_font,  
+            .string = stats_text,
+            .size = strlen(stats_text),
+            .pos = { 15, (float)platform->screen_height - 12 - lines * (float)simple_font->font_char_height },
+            .color = { 255, 255, 255, 255 },
+            .scale = 1
+        };
+        render_text(platform, &stats);
+    }
+
     prof_sort_results();
     // prof_print_results();
     prof_reset();
@@ -827,6 +3643,39 @@ EXPORT void app_cleanup(platform_api_t *platform, app_state_t *state)
         cuda_cleanup(); 
     #endif
 
+    // the workers run dll code, they have to be gone before it is unloaded
+    pool_stop();
+
+    ref_orbit_free(&g_ref_orbit);
+    bla_free(&g_bla_table);
+
+    free(g_tile_costs.cost);
+    free(g_tile_costs.predicted);
+    g_tile_costs = (tile_cost_map_t){0};
+
+    for (int w = 0; w < g_equalize.worker_count; ++w) {
+        free(g_equalize.workers[w].bins);
+    }
+    free(g_equalize.workers);
+    free(g_equalize.cdf);
+    g_equalize = (equalize_t){0};
+
+    mutex_destroy(&g_preview_screen.lock);
+    free(g_preview_screen.pixels);
+    g_preview_screen = (preview_screen_t){0};
+
+    free(g_frame_cache.counts);
+    free(g_frame_cache.smooth);
+    free(g_frame_cache.scratch);
+    free(g_frame_cache.smooth_scratch);
+    free(g_frame_cache.aa_pixels);
+    free(g_frame_cache.aa_smooth);
+    free(g_frame_cache.accum_sum);
+    free(g_frame_cache.accum_count);
+    free(g_frame_cache.accum_stable);
+    free(g_frame_cache.accum_pixels);
+    g_frame_cache = (frame_cache_t){0};
+
     printf("Cleanup called (before reload/exit)\n");
 }
 
@@ -841,6 +3690,33 @@ EXPORT void app_on_reload(platform_api_t *platform, app_state_t *state)
     for (int i = 0; i < 512; ++i){
         color_map[i] = rgb_from_wavelength(380.0 + (i * 400.0 / 512));
     }
+
+    // the kernel table is a dll global, the fresh copy is unbound
+    kernels_init();
+
+    // so do the generations, frames in flight compare against the state's
+    atomic_store_i64(&g_view_generation, state->view_generation);
+
+    pool_start(0);
+    mutex_init(&g_preview_screen.lock);
+
+    // state saved by a build that did not have these yet
+    if (state->max_iterations <= 0) {
+        state->max_iterations = 1024;
+        state->use_bla = true;
+        state->use_direct_hp = false;
+    }
+    if (!(state->target_scale > 0.0)) {
+        state->target_scale = state->view_scale;
+    }
+    if (!(state->palette_density > 0.0f)) {
+        state->palette = COLOR_BLUE;
+        state->palette_density = 1.0f;
+        state->palette_offset = 0.0f;
+        state->cycle_palette = false;
+        state->equalize_colors = false;
+    }
+
     #ifdef USE_CUDA
         cuda_init(1920,1080); 
     #endif
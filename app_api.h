@@ -4,11 +4,13 @@
 #include <stdint.h>
 #include <stdbool.h>
 
+#include "hp.h"
+
 typedef struct {
     uint8_t r, g, b, a;
 } color_t;
 
-typedef struct 
+typedef struct platform_api_t
 {
     uint32_t screen_width;
     uint32_t screen_height;
@@ -41,6 +43,11 @@ typedef struct
 
     bool should_quit;
     bool capture_frame;
+    bool frame_incomplete;      // app_render gave up on a stale view, the pixels are partial
+
+    // shows pixels (the frame, or a copy of it while workers still write to the frame) and lets
+    // app_render carry on, only from inside app_render
+    void (*present)(struct platform_api_t *platform, const color_t *pixels);
 } platform_api_t;
 
 /*
@@ -56,18 +63,41 @@ typedef struct
     double view_center_x;
     double view_center_y;
     double view_scale;
+    int64_t view_scale_exp;     // past a double's range the scale is view_scale * 2^view_scale_exp
+    int64_t view_generation;    // goes up every time app_update changes the view
     double target_scale;
 
+    // the real view centre, view_center_x/y are just the closest doubles
+    hp_t view_center_hp_x;
+    hp_t view_center_hp_y;
+
     bool is_panning;
     int pan_start_x;
     int pan_start_y;
     double pan_start_center_x;
     double pan_start_center_y;
+    hp_t pan_start_center_hp_x;
+    hp_t pan_start_center_hp_y;
 
     int last_mouse_x;
     int last_mouse_y;
 
     bool use_gpu;
+    bool show_stats;
+
+    int max_iterations;
+    bool use_bla;           // deep zoom, skip iterations with linear approximation steps
+    bool use_direct_hp;     // iterate every pixel at full precision, slow but exact
+    bool use_subdivision;   // fill rectangles whose border has a single iteration count
+    int aa_samples;         // extra samples a still frame may spend on its edges (anti-aliasing), 0 for none
+    int accumulate_samples; // samples per pixel a still view keeps averaging in, 0 for none
+
+    // colouring, changing any of it only recolours the last frame
+    int palette;
+    float palette_density;  // times the palette repeats over max_iterations
+    float palette_offset;   // in palette lengths, [0, 1)
+    bool cycle_palette;     // animate palette_offset
+    bool equalize_colors;   // spread the palette by how many pixels have each count
         
     void *user_data;
 } app_state_t;
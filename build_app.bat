@@ -5,7 +5,7 @@ if not exist build mkdir build
 :: Set environment vars for MSVC compiler
 call "D:\Programming\Software\msvc\setup_x64.bat" x64
 
-set CFLAGS=/Zi /EHsc /D_AMD64_ /fp:fast /W4 /MD /nologo /utf-8 /std:clatest /arch:AVX /DBUILD_DLL
+set CFLAGS=/Zi /EHsc /D_AMD64_ /fp:fast /W4 /MD /nologo /utf-8 /std:clatest /DBUILD_DLL
 set L_FLAGS=/DLL
 set SRC=..\app.c
 set INCLUDE_DIRS=/I..\include /I..\external\include\
@@ -45,11 +45,11 @@ if "%USE_CUDA%"=="yes" (
     
     :: Compile C code
     if "%BUILD_TYPE%"=="rel" (
-        cl /Zi /EHsc /D_AMD64_ /fp:fast /W4 /MD /nologo /arch:AVX /DBUILD_DLL /DUSE_CUDA /O2 ^
+        cl /Zi /EHsc /D_AMD64_ /fp:fast /W4 /MD /nologo /DBUILD_DLL /DUSE_CUDA /O2 ^
            /I..\include /I..\external\include /I"%CUDA_PATH%\include" ^
            /c ..\app.c /Foapp.obj
     ) else (
-        cl /Zi /EHsc /D_AMD64_ /fp:fast /W4 /MD /nologo /arch:AVX /DBUILD_DLL /DUSE_CUDA ^
+        cl /Zi /EHsc /D_AMD64_ /fp:fast /W4 /MD /nologo /DBUILD_DLL /DUSE_CUDA ^
            /I..\include /I..\external\include /I"%CUDA_PATH%\include" ^
            /c ..\app.c /Foapp.obj
     )
@@ -82,12 +82,12 @@ echo Building with CPU only...
 
 if "%BUILD_TYPE%"=="rel" (
     echo Building app DLL release CPU only...
-    cl /Zi /EHsc /D_AMD64_ /fp:fast /W4 /MD /nologo /arch:AVX /DBUILD_DLL /O2 ^
+    cl /Zi /EHsc /D_AMD64_ /fp:fast /W4 /MD /nologo /DBUILD_DLL /O2 ^
        /I..\include /I..\external\include ^
        ..\app.c /Fe:app.dll /link /DLL /LIBPATH:..\external\lib
 ) else (
     echo Building app DLL debug CPU only...
-    cl /Zi /EHsc /D_AMD64_ /fp:fast /W4 /MD /nologo /arch:AVX /DBUILD_DLL ^
+    cl /Zi /EHsc /D_AMD64_ /fp:fast /W4 /MD /nologo /DBUILD_DLL ^
        /I..\include /I..\external\include ^
        ..\app.c /Fe:app.dll /link /DLL /LIBPATH:..\external\lib
 )
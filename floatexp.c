@@ -0,0 +1,67 @@
+#include "floatexp.h"
+
+#include <math.h>
+
+fe_t fe_make(double m, int64_t e)
+{
+    if (m == 0.0) {
+        return (fe_t){ 0.0, FE_ZERO_EXP };
+    }
+
+    int shift;
+    double mantissa = frexp(m, &shift);
+    return (fe_t){ mantissa, e + shift };
+}
+
+fe_t fe_from_double(double value)
+{
+    return fe_make(value, 0);
+}
+
+double fe_to_double(fe_t a)
+{
+    // anything past these is 0 or inf anyway, ldexp only takes an int
+    if (a.e < -1100) return 0.0 * a.m;
+    if (a.e > 1100)  return a.m * INFINITY;
+    return ldexp(a.m, (int)a.e);
+}
+
+fe_t fe_add(fe_t a, fe_t b)
+{
+    if (a.e < b.e) {
+        fe_t t = a; a = b; b = t;
+    }
+
+    int64_t d = a.e - b.e;
+    if (d > FE_MAX_ALIGN) {
+        return a;
+    }
+
+    return fe_make(a.m + ldexp(b.m, -(int)d), a.e);
+}
+
+fe_t fe_sub(fe_t a, fe_t b)
+{
+    return fe_add(a, fe_neg(b));
+}
+
+fe_t fe_mul(fe_t a, fe_t b)
+{
+    return fe_make(a.m * b.m, a.e + b.e);
+}
+
+fe_t fe_mul_double(fe_t a, double b)
+{
+    return fe_mul(a, fe_from_double(b));
+}
+
+fe_t fe_div(fe_t a, fe_t b)
+{
+    return fe_make(a.m / b.m, a.e - b.e);
+}
+
+double fe_log2(fe_t a)
+{
+    if (fe_is_zero(a)) return -INFINITY;
+    return log2(fabs(a.m)) + (double)a.e;
+}
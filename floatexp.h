@@ -0,0 +1,153 @@
+#ifndef FLOATEXP_H_
+#define FLOATEXP_H_
+
+#include <stdint.h>
+#include <stdbool.h>
+
+#include "kernels.h"
+
+/*
+    Floating point with a separate exponent, value = m * 2^e.
+
+    A double runs out of exponent around 1e-308 while the pixel spacing and the
+    deltas of a deep zoom keep going, the mantissa still only needs 53 bits though
+    so splitting the exponent off is all it takes, no bignum.
+
+    Kept normalized: 0.5 <= |m| < 1, zero is m = 0 with e = FE_ZERO_EXP so it loses
+    every comparison and vanishes in every add without a special case.
+ */
+typedef struct
+{
+    double m;
+    int64_t e;
+} fe_t;
+
+#define FE_ZERO_EXP (-((int64_t)1 << 60))
+
+/*
+    Sums whose exponents are further apart than this just return the bigger one,
+    the other is well below the last bit of the mantissa.
+ */
+#define FE_MAX_ALIGN 1000
+
+fe_t fe_make(double m, int64_t e);
+fe_t fe_from_double(double value);
+
+/* Underflows to 0 (and overflows to inf) like a double would */
+double fe_to_double(fe_t a);
+
+fe_t fe_add(fe_t a, fe_t b);
+fe_t fe_sub(fe_t a, fe_t b);
+fe_t fe_mul(fe_t a, fe_t b);
+fe_t fe_mul_double(fe_t a, double b);
+fe_t fe_div(fe_t a, fe_t b);
+
+/* log2 |a|, -inf for 0 */
+double fe_log2(fe_t a);
+
+static inline fe_t fe_neg(fe_t a)
+{
+    return (fe_t){ -a.m, a.e };
+}
+
+static inline bool fe_is_zero(fe_t a)
+{
+    return a.m == 0.0;
+}
+
+/* |a| < |b| */
+static inline bool fe_less_abs(fe_t a, fe_t b)
+{
+    return a.e < b.e || (a.e == b.e && (a.m < 0.0 ? -a.m : a.m) < (b.m < 0.0 ? -b.m : b.m));
+}
+
+#if KERNELS_X86
+
+/*
+    Four at a time, mantissas in one register and exponents in another.
+    Normalizing only needs the exponent field of the double, rewritten to 2^-1 and
+    whatever was there moved to e, so everything stays in integer/bit ops.
+ */
+typedef struct
+{
+    __m256d m;
+    __m256i e;
+} fe4_t;
+
+KERNEL_TARGET("avx2")
+static inline fe4_t fe4_normalize(__m256d m, __m256i e)
+{
+    const __m256i exp_mask = _mm256_set1_epi64x(0x7ffll << 52);
+    const __m256i half = _mm256_set1_epi64x(1022ll << 52);
+
+    __m256i bits = _mm256_castpd_si256(m);
+    __m256i biased = _mm256_srli_epi64(_mm256_and_si256(bits, exp_mask), 52);
+    __m256i mantissa = _mm256_or_si256(_mm256_andnot_si256(exp_mask, bits), half);
+
+    __m256d zero = _mm256_cmp_pd(m, _mm256_setzero_pd(), _CMP_EQ_OQ);
+
+    fe4_t r;
+    r.m = _mm256_andnot_pd(zero, _mm256_castsi256_pd(mantissa));
+    r.e = _mm256_add_epi64(e, _mm256_sub_epi64(biased, _mm256_set1_epi64x(1022)));
+    r.e = _mm256_blendv_epi8(r.e, _mm256_set1_epi64x(FE_ZERO_EXP), _mm256_castpd_si256(zero));
+    return r;
+}
+
+KERNEL_TARGET("avx2")
+static inline fe4_t fe4_from_double(__m256d value)
+{
+    return fe4_normalize(value, _mm256_setzero_si256());
+}
+
+KERNEL_TARGET("avx2")
+static inline fe4_t fe4_mul(fe4_t a, fe4_t b)
+{
+    return fe4_normalize(_mm256_mul_pd(a.m, b.m), _mm256_add_epi64(a.e, b.e));
+}
+
+// 2^-d for 0 <= d <= FE_MAX_ALIGN, built straight into the exponent field
+KERNEL_TARGET("avx2")
+static inline __m256d fe4_exp2_neg(__m256i d)
+{
+    __m256i limit = _mm256_set1_epi64x(FE_MAX_ALIGN);
+    d = _mm256_blendv_epi8(d, limit, _mm256_cmpgt_epi64(d, limit));
+    return _mm256_castsi256_pd(_mm256_slli_epi64(_mm256_sub_epi64(_mm256_set1_epi64x(1023), d), 52));
+}
+
+KERNEL_TARGET("avx2")
+static inline fe4_t fe4_add(fe4_t a, fe4_t b)
+{
+    // line both up with the bigger exponent
+    __m256i e = _mm256_blendv_epi8(a.e, b.e, _mm256_cmpgt_epi64(b.e, a.e));
+    __m256d ma = _mm256_mul_pd(a.m, fe4_exp2_neg(_mm256_sub_epi64(e, a.e)));
+    __m256d mb = _mm256_mul_pd(b.m, fe4_exp2_neg(_mm256_sub_epi64(e, b.e)));
+    return fe4_normalize(_mm256_add_pd(ma, mb), e);
+}
+
+KERNEL_TARGET("avx2")
+static inline fe4_t fe4_neg(fe4_t a)
+{
+    a.m = _mm256_xor_pd(a.m, _mm256_set1_pd(-0.0));
+    return a;
+}
+
+KERNEL_TARGET("avx2")
+static inline fe4_t fe4_sub(fe4_t a, fe4_t b)
+{
+    return fe4_add(a, fe4_neg(b));
+}
+
+// |a| < |b| as a lane mask
+KERNEL_TARGET("avx2")
+static inline __m256i fe4_less_abs(fe4_t a, fe4_t b)
+{
+    __m256d abs_mask = _mm256_castsi256_pd(_mm256_set1_epi64x(0x7fffffffffffffffll));
+    __m256i m_less = _mm256_castpd_si256(_mm256_cmp_pd(_mm256_and_pd(a.m, abs_mask), _mm256_and_pd(b.m, abs_mask), _CMP_LT_OQ));
+    __m256i e_less = _mm256_cmpgt_epi64(b.e, a.e);
+    __m256i e_equal = _mm256_cmpeq_epi64(a.e, b.e);
+    return _mm256_or_si256(e_less, _mm256_and_si256(e_equal, m_less));
+}
+
+#endif
+
+#endif
@@ -0,0 +1,334 @@
+#include "hp.h"
+
+#include <math.h>
+#include <string.h>
+
+void hp_zero(hp_t *r)
+{
+    memset(r->limb, 0, sizeof(r->limb));
+}
+
+void hp_copy(hp_t *r, const hp_t *a, int limbs)
+{
+    memcpy(r->limb, a->limb, limbs * sizeof(uint32_t));
+}
+
+bool hp_is_negative(const hp_t *a)
+{
+    return (a->limb[0] >> 31) != 0;
+}
+
+/*
+    Peel off 32 bits at a time, multiplying by 2^32 and subtracting the integer
+    part are both exact so nothing of the double is lost.
+ */
+void hp_from_double(hp_t *r, double value)
+{
+    hp_zero(r);
+
+    bool negative = value < 0.0;
+    double frac = fabs(value);
+
+    double whole = floor(frac);
+    r->limb[0] = (uint32_t)whole;
+    frac -= whole;
+
+    for (int k = 1; k < HP_MAX_LIMBS && frac != 0.0; ++k)
+    {
+        frac *= 4294967296.0;
+        whole = floor(frac);
+        r->limb[k] = (uint32_t)whole;
+        frac -= whole;
+    }
+
+    if (negative) {
+        hp_neg(r, r, HP_MAX_LIMBS);
+    }
+}
+
+/*
+    Only the first three non-zero limbs matter for a 53 bit mantissa, which also
+    means tiny values deep in the fraction still come out with full precision.
+ */
+double hp_to_double(const hp_t *a, int limbs)
+{
+    hp_t magnitude;
+    bool negative = hp_is_negative(a);
+
+    if (negative) {
+        hp_neg(&magnitude, a, limbs);
+        a = &magnitude;
+    }
+
+    int first = 0;
+    while (first < limbs && a->limb[first] == 0) {
+        first++;
+    }
+
+    int last = (first + 2 < limbs) ? first + 2 : limbs - 1;
+
+    double result = 0.0;
+    for (int k = last; k >= first; --k) {
+        result += ldexp((double)a->limb[k], -32 * k);
+    }
+
+    return negative ? -result : result;
+}
+
+/*
+    Same peeling as hp_from_double, starting at the limb the top bits of the value
+    land in so a tiny value keeps all its bits.
+ */
+void hp_from_fe(hp_t *r, fe_t value)
+{
+    hp_zero(r);
+
+    // m * 2^e is below 2^e, it fits limb k once scaled by 2^(32k) for k up to (32 - e) / 32
+    int64_t first = (32 - value.e) / 32;
+    if (fe_is_zero(value) || first >= HP_MAX_LIMBS) {
+        return;
+    }
+    if (first < 0) first = 0;
+
+    double frac = ldexp(fabs(value.m), (int)(value.e + 32 * first));
+
+    for (int k = (int)first; k < HP_MAX_LIMBS && frac != 0.0; ++k)
+    {
+        double whole = floor(frac);
+        r->limb[k] = (uint32_t)whole;
+        frac = (frac - whole) * 4294967296.0;
+    }
+
+    if (value.m < 0.0) {
+        hp_neg(r, r, HP_MAX_LIMBS);
+    }
+}
+
+fe_t hp_to_fe(const hp_t *a, int limbs)
+{
+    hp_t magnitude;
+    bool negative = hp_is_negative(a);
+
+    if (negative) {
+        hp_neg(&magnitude, a, limbs);
+        a = &magnitude;
+    }
+
+    int first = 0;
+    while (first < limbs && a->limb[first] == 0) {
+        first++;
+    }
+
+    if (first == limbs) {
+        return fe_from_double(0.0);
+    }
+
+    int last = (first + 2 < limbs) ? first + 2 : limbs - 1;
+
+    // relative to the first limb, the exponent goes on afterwards
+    double result = 0.0;
+    for (int k = last; k >= first; --k) {
+        result += ldexp((double)a->limb[k], -32 * (k - first));
+    }
+
+    return fe_make(negative ? -result : result, -32 * (int64_t)first);
+}
+
+void hp_add(hp_t *r, const hp_t *a, const hp_t *b, int limbs)
+{
+    uint64_t carry = 0;
+    for (int k = limbs - 1; k >= 0; --k)
+    {
+        uint64_t sum = (uint64_t)a->limb[k] + b->limb[k] + carry;
+        r->limb[k] = (uint32_t)sum;
+        carry = sum >> 32;
+    }
+}
+
+void hp_sub(hp_t *r, const hp_t *a, const hp_t *b, int limbs)
+{
+    // a - b = a + ~b + 1
+    uint64_t carry = 1;
+    for (int k = limbs - 1; k >= 0; --k)
+    {
+        uint64_t sum = (uint64_t)a->limb[k] + (uint32_t)~b->limb[k] + carry;
+        r->limb[k] = (uint32_t)sum;
+        carry = sum >> 32;
+    }
+}
+
+void hp_neg(hp_t *r, const hp_t *a, int limbs)
+{
+    uint64_t carry = 1;
+    for (int k = limbs - 1; k >= 0; --k)
+    {
+        uint64_t sum = (uint64_t)(uint32_t)~a->limb[k] + carry;
+        r->limb[k] = (uint32_t)sum;
+        carry = sum >> 32;
+    }
+}
+
+static inline int min_limb(int a, int b)
+{
+    return a < b ? a : b;
+}
+
+/*
+    Schoolbook multiply of the magnitudes. The full product has 2n limbs and
+    product[1 .. n] lines up with our format, product[0] would be bits above the
+    integer part.
+
+    Only the columns up to n + 1 are summed, the rest is below our precision and
+    would only carry a few units into the last limb (the limb count has guard bits
+    for that), this halves the work.
+ */
+static void hp_mul_magnitude(uint32_t *product, const hp_t *a, const hp_t *b, int limbs)
+{
+    memset(product, 0, (limbs + 2) * sizeof(uint32_t));
+
+    for (int i = limbs - 1; i >= 0; --i)
+    {
+        uint64_t carry = 0;
+        for (int j = min_limb(limbs - 1, limbs - i); j >= 0; --j)
+        {
+            uint64_t t = (uint64_t)a->limb[i] * b->limb[j] + product[i + j + 1] + carry;
+            product[i + j + 1] = (uint32_t)t;
+            carry = t >> 32;
+        }
+        product[i] = (uint32_t)carry;
+    }
+}
+
+void hp_mul(hp_t *r, const hp_t *a, const hp_t *b, int limbs)
+{
+    hp_t abs_a, abs_b;
+    bool negative = hp_is_negative(a) != hp_is_negative(b);
+
+    if (hp_is_negative(a)) {
+        hp_neg(&abs_a, a, limbs);
+        a = &abs_a;
+    }
+    if (hp_is_negative(b)) {
+        hp_neg(&abs_b, b, limbs);
+        b = &abs_b;
+    }
+
+    uint32_t product[HP_MAX_LIMBS + 2];
+    hp_mul_magnitude(product, a, b, limbs);
+
+    memcpy(r->limb, product + 1, limbs * sizeof(uint32_t));
+
+    if (negative) {
+        hp_neg(r, r, limbs);
+    }
+}
+
+/*
+    a_i * a_j shows up twice for i != j, so the cross terms are summed once and
+    doubled with a shift, then the squares on the diagonal are added, about half
+    the multiplies of hp_mul. Same column cut off as hp_mul.
+ */
+void hp_sqr(hp_t *r, const hp_t *a, int limbs)
+{
+    hp_t abs_a;
+
+    if (hp_is_negative(a)) {
+        hp_neg(&abs_a, a, limbs);
+        a = &abs_a;
+    }
+
+    uint32_t product[HP_MAX_LIMBS + 2];
+    memset(product, 0, (limbs + 2) * sizeof(uint32_t));
+
+    // cross terms, i < j, past i = limbs / 2 every term is below the cut off
+    for (int i = min_limb(limbs - 2, limbs / 2); i >= 0; --i)
+    {
+        uint64_t carry = 0;
+        for (int j = min_limb(limbs - 1, limbs - i); j > i; --j)
+        {
+            uint64_t t = (uint64_t)a->limb[i] * a->limb[j] + product[i + j + 1] + carry;
+            product[i + j + 1] = (uint32_t)t;
+            carry = t >> 32;
+        }
+        product[i + i + 1] = (uint32_t)carry;
+    }
+
+    // double them, the top bit falls off the same way product[0] does
+    for (int k = 0; k < limbs + 1; ++k) {
+        product[k] = (product[k] << 1) | (product[k + 1] >> 31);
+    }
+    product[limbs + 1] <<= 1;
+
+    // the squares, a_i^2 has its low half on column 2i + 1 and its high half on 2i
+    uint64_t carry = 0;
+    for (int k = limbs + 1; k >= 0; --k)
+    {
+        uint64_t sum = (uint64_t)product[k] + carry;
+
+        int i = k / 2;
+        if (2 * i <= limbs)
+        {
+            uint64_t square = (uint64_t)a->limb[i] * a->limb[i];
+            sum += (k & 1) ? (uint32_t)square : (square >> 32);
+        }
+
+        product[k] = (uint32_t)sum;
+        carry = sum >> 32;
+    }
+
+    memcpy(r->limb, product + 1, limbs * sizeof(uint32_t));
+}
+
+void hp_add_double(hp_t *r, const hp_t *a, double b, int limbs)
+{
+    hp_t value;
+    hp_from_double(&value, b);
+    hp_add(r, a, &value, limbs);
+}
+
+void hp_add_fe(hp_t *r, const hp_t *a, fe_t b, int limbs)
+{
+    hp_t value;
+    hp_from_fe(&value, b);
+    hp_add(r, a, &value, limbs);
+}
+
+// the top two limbs, plenty for comparing against the escape radius
+static double hp_to_double_coarse(const hp_t *a)
+{
+    return (double)(int32_t)a->limb[0] + a->limb[1] * (1.0 / 4294967296.0);
+}
+
+double hp_mandelbrot_step(hp_t *z_re, hp_t *z_im, const hp_t *c_re, const hp_t *c_im, int limbs)
+{
+    hp_t re2, im2, sum2;
+
+    hp_add(&sum2, z_re, z_im, limbs);
+    hp_sqr(&sum2, &sum2, limbs);
+    hp_sqr(&re2, z_re, limbs);
+    hp_sqr(&im2, z_im, limbs);
+
+    double magnitude = hp_to_double_coarse(&re2) + hp_to_double_coarse(&im2);
+
+    // 2 re im = (re + im)^2 - re^2 - im^2
+    hp_sub(z_im, &sum2, &re2, limbs);
+    hp_sub(z_im, z_im, &im2, limbs);
+    hp_add(z_im, z_im, c_im, limbs);
+
+    hp_sub(z_re, &re2, &im2, limbs);
+    hp_add(z_re, z_re, c_re, limbs);
+
+    return magnitude;
+}
+
+int hp_limbs_for_scale(fe_t scale)
+{
+    // bits below the point to resolve one pixel, plus 64 guard bits for the orbit to lose
+    double pixel_bits = fe_is_zero(scale) ? 32.0 * HP_MAX_LIMBS : -fe_log2(scale);
+    int bits = (int)fmin(ceil(pixel_bits), 32.0 * HP_MAX_LIMBS) + 64;
+    int limbs = 1 + (bits + 31) / 32;
+
+    if (limbs < 2) limbs = 2;
+    if (limbs > HP_MAX_LIMBS) limbs = HP_MAX_LIMBS;
+    return limbs;
+}
@@ -0,0 +1,57 @@
+#ifndef HP_H_
+#define HP_H_
+
+#include <stdint.h>
+#include <stdbool.h>
+
+#include "floatexp.h"
+
+/*
+    High precision fixed point numbers made of 32 bit limbs.
+
+    limb[0] is the (signed) integer part and limb[k] weighs 2^(-32k), the whole
+    thing is a single two's complement number so add/sub are just a carry chain.
+
+    The precision is passed to every op instead of being stored, the same value can
+    be read at a lower precision by ignoring the trailing limbs, limbs past the
+    requested count are left untouched in the result.
+ */
+#define HP_MAX_LIMBS 128
+
+typedef struct
+{
+    uint32_t limb[HP_MAX_LIMBS];
+} hp_t;
+
+void hp_zero(hp_t *r);
+void hp_copy(hp_t *r, const hp_t *a, int limbs);
+bool hp_is_negative(const hp_t *a);
+
+/* Exact for any double with a magnitude below 2^31 */
+void hp_from_double(hp_t *r, double value);
+double hp_to_double(const hp_t *a, int limbs);
+
+/* Same with the exponent kept apart, for the differences too small for a double */
+void hp_from_fe(hp_t *r, fe_t value);
+fe_t hp_to_fe(const hp_t *a, int limbs);
+
+void hp_add(hp_t *r, const hp_t *a, const hp_t *b, int limbs);
+void hp_sub(hp_t *r, const hp_t *a, const hp_t *b, int limbs);
+void hp_neg(hp_t *r, const hp_t *a, int limbs);
+void hp_mul(hp_t *r, const hp_t *a, const hp_t *b, int limbs);
+void hp_sqr(hp_t *r, const hp_t *a, int limbs);
+void hp_add_double(hp_t *r, const hp_t *a, double b, int limbs);
+void hp_add_fe(hp_t *r, const hp_t *a, fe_t b, int limbs);
+
+/*
+    z = z^2 + c in three squarings, returns |z|^2 of the z that went in (roughly,
+    only good enough for the escape test).
+    |z| has to be small enough for (re + im)^2 to fit the integer limb, anything
+    that only just escaped is fine.
+ */
+double hp_mandelbrot_step(hp_t *z_re, hp_t *z_im, const hp_t *c_re, const hp_t *c_im, int limbs);
+
+/* How many limbs resolve a pixel spacing of "scale" with some guard bits to spare */
+int hp_limbs_for_scale(fe_t scale);
+
+#endif
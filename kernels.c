@@ -0,0 +1,665 @@
+#include "kernels.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+kernel_table_t g_kernels = { KERNEL_SCALAR, "scalar", escape_time_scalar, escape_time_float_scalar, escape_time_dd_scalar };
+
+/*
+    Reference kernel, one point at a time.
+
+    Remember :
+    - (z_re + z_im i)^2 = z_re^2 - z_im^2 + {(2 * z_re * z_im) i}
+    - z^2 + c = (z_re^2 - z_im^2 + c_re) + (2 * z_re * z_im + c_im) i
+ */
+void escape_time_scalar(const escape_params_t *params, const double *re, const double *im, int count, int *iterations, float *magnitudes, escape_stats_t *stats)
+{
+    const double limit = 4.0;  // (we cannot get past the escape radius = 2.0 so no need to calculate further (squared so we dont deal with sqrt))
+    const double tolerance = params->cycle_tolerance * params->cycle_tolerance;
+
+    for (int i = 0; i < count; ++i)
+    {
+        if (!params->julia && in_main_cardioid_or_bulb(re[i], im[i])) 
+        {
+            iterations[i] = params->max_iterations;
+            magnitudes[i] = 0.0f;
+            stats->interior_skipped++;
+            continue;
+        }
+
+        double z_re = params->julia ? re[i] : 0.0;
+        double z_im = params->julia ? im[i] : 0.0;
+        double c_re = params->julia ? params->julia_re : re[i];
+        double c_im = params->julia ? params->julia_im : im[i];
+
+        int iteration = 0;
+
+        double saved_re = z_re;
+        double saved_im = z_im;
+        int check_at = CYCLE_FIRST_CHECK;
+        bool periodic = false;
+
+        while (iteration < params->max_iterations)
+        {
+            double re_tmp = z_re*z_re - z_im*z_im + c_re;
+            z_im = 2 * z_re * z_im + c_im;
+            z_re = re_tmp;
+            iteration++;
+
+            // distance larger than escape radius abort
+            if (z_re*z_re + z_im*z_im > limit)
+                break;
+
+            if (iteration == check_at)
+            {
+                saved_re = z_re;
+                saved_im = z_im;
+                check_at *= 2;
+            }
+            else
+            {
+                double d_re = z_re - saved_re;
+                double d_im = z_im - saved_im;
+                if (d_re*d_re + d_im*d_im < tolerance) {
+                    periodic = true;
+                    break;
+                }
+            }
+        }
+
+        if (periodic)
+        {
+            stats->cycle_points++;
+            stats->cycle_iterations_saved += params->max_iterations - iteration;
+            iteration = params->max_iterations;
+        }
+
+        iterations[i] = iteration;
+        magnitudes[i] = (float)(z_re*z_re + z_im*z_im);
+    }
+}
+
+/*
+    The vector kernels iterate a whole register of points in lockstep, every lane
+    keeps an "active" mask that is cleared the moment that lane escapes, an escaped
+    lane stops counting and keeps its last z, the loop ends when no lane is active
+    or we hit max_iterations.
+
+    Two independent registers are interleaved per step, a single z chain is
+    latency bound (mul -> add -> blend -> mul) so this keeps the FP units busy.
+ */
+#if KERNELS_X86
+static int mask_popcount(unsigned int mask)
+{
+    int n = 0;
+    while (mask) {
+        mask &= mask - 1;
+        n++;
+    }
+    return n;
+}
+
+/*
+    Vector versions of in_main_cardioid_or_bulb(), all ones in the lanes that are inside
+ */
+KERNEL_TARGET("sse2")
+static inline __m128d interior_mask_sse2(__m128d x, __m128d y)
+{
+    __m128d y2 = _mm_mul_pd(y, y);
+    __m128d xq = _mm_sub_pd(x, _mm_set1_pd(0.25));
+    __m128d q  = _mm_add_pd(_mm_mul_pd(xq, xq), y2);
+    __m128d cardioid = _mm_cmple_pd(_mm_mul_pd(q, _mm_add_pd(q, xq)), _mm_mul_pd(_mm_set1_pd(0.25), y2));
+
+    __m128d xb = _mm_add_pd(x, _mm_set1_pd(1.0));
+    __m128d bulb = _mm_cmple_pd(_mm_add_pd(_mm_mul_pd(xb, xb), y2), _mm_set1_pd(0.0625));
+
+    return _mm_or_pd(cardioid, bulb);
+}
+
+KERNEL_TARGET("avx2,fma")
+static inline __m256d interior_mask_avx2(__m256d x, __m256d y)
+{
+    __m256d y2 = _mm256_mul_pd(y, y);
+    __m256d xq = _mm256_sub_pd(x, _mm256_set1_pd(0.25));
+    __m256d q  = _mm256_fmadd_pd(xq, xq, y2);
+    __m256d cardioid = _mm256_cmp_pd(_mm256_mul_pd(q, _mm256_add_pd(q, xq)), _mm256_mul_pd(_mm256_set1_pd(0.25), y2), _CMP_LE_OQ);
+
+    __m256d xb = _mm256_add_pd(x, _mm256_set1_pd(1.0));
+    __m256d bulb = _mm256_cmp_pd(_mm256_fmadd_pd(xb, xb, y2), _mm256_set1_pd(0.0625), _CMP_LE_OQ);
+
+    return _mm256_or_pd(cardioid, bulb);
+}
+
+KERNEL_TARGET("avx512f")
+static inline __mmask8 interior_mask_avx512(__m512d x, __m512d y)
+{
+    __m512d y2 = _mm512_mul_pd(y, y);
+    __m512d xq = _mm512_sub_pd(x, _mm512_set1_pd(0.25));
+    __m512d q  = _mm512_fmadd_pd(xq, xq, y2);
+    __mmask8 cardioid = _mm512_cmp_pd_mask(_mm512_mul_pd(q, _mm512_add_pd(q, xq)), _mm512_mul_pd(_mm512_set1_pd(0.25), y2), _CMP_LE_OQ);
+
+    __m512d xb = _mm512_add_pd(x, _mm512_set1_pd(1.0));
+    __mmask8 bulb = _mm512_cmp_pd_mask(_mm512_fmadd_pd(xb, xb, y2), _mm512_set1_pd(0.0625), _CMP_LE_OQ);
+
+    return cardioid | bulb;
+}
+
+KERNEL_TARGET("sse2")
+void escape_time_sse2(const escape_params_t *params, const double *re, const double *im, int count, int *iterations, float *magnitudes, escape_stats_t *stats)
+{
+    const __m128d limit = _mm_set1_pd(4.0);
+    const __m128d one   = _mm_set1_pd(1.0);
+    const __m128d max_iterations = _mm_set1_pd((double)params->max_iterations);
+    const __m128d tolerance = _mm_set1_pd(params->cycle_tolerance * params->cycle_tolerance);
+
+    for (int i = 0; i < count; i += 4)
+    {
+        __m128d z_re[2], z_im[2], c_re[2], c_im[2];
+        __m128d re2[2], im2[2], active[2], counts[2];
+        __m128d saved_re[2], saved_im[2];
+        __m128d saved_iterations = _mm_setzero_pd();
+        int check_at = CYCLE_FIRST_CHECK;
+
+        for (int v = 0; v < 2; ++v)
+        {
+            int base = i + v * 2;
+            int left = count - base;
+
+            // no masked loads before avx, pad the tail by hand
+            double p_re[2] = {0.0, 0.0};
+            double p_im[2] = {0.0, 0.0};
+            double valid[2] = {0.0, 0.0};
+            for (int k = 0; k < 2 && k < left; ++k) {
+                p_re[k] = re[base + k];
+                p_im[k] = im[base + k];
+                valid[k] = 1.0;
+            }
+            active[v] = _mm_cmpeq_pd(_mm_loadu_pd(valid), one);
+
+            if (params->julia)
+            {
+                z_re[v] = _mm_loadu_pd(p_re);
+                z_im[v] = _mm_loadu_pd(p_im);
+                c_re[v] = _mm_set1_pd(params->julia_re);
+                c_im[v] = _mm_set1_pd(params->julia_im);
+            }
+            else
+            {
+                z_re[v] = _mm_setzero_pd();
+                z_im[v] = _mm_setzero_pd();
+                c_re[v] = _mm_loadu_pd(p_re);
+                c_im[v] = _mm_loadu_pd(p_im);
+            }
+
+            re2[v] = _mm_mul_pd(z_re[v], z_re[v]);
+            im2[v] = _mm_mul_pd(z_im[v], z_im[v]);
+            counts[v] = _mm_setzero_pd();
+            saved_re[v] = z_re[v];
+            saved_im[v] = z_im[v];
+
+            // interior lanes start out finished at max_iterations
+            if (!params->julia)
+            {
+                __m128d interior = _mm_and_pd(interior_mask_sse2(c_re[v], c_im[v]), active[v]);
+                active[v] = _mm_andnot_pd(interior, active[v]);
+                counts[v] = _mm_and_pd(interior, max_iterations);
+                stats->interior_skipped += mask_popcount(_mm_movemask_pd(interior));
+            }
+        }
+
+        for (int iteration = 0; iteration < params->max_iterations; ++iteration)
+        {
+            if (_mm_movemask_pd(_mm_or_pd(active[0], active[1])) == 0)
+                break;
+
+            bool save = (iteration + 1 == check_at);
+
+            for (int v = 0; v < 2; ++v)
+            {
+                __m128d n_re = _mm_add_pd(_mm_sub_pd(re2[v], im2[v]), c_re[v]);
+                __m128d n_im = _mm_add_pd(_mm_mul_pd(_mm_add_pd(z_re[v], z_re[v]), z_im[v]), c_im[v]);
+
+                // blendv is sse4.1
+                z_re[v] = _mm_or_pd(_mm_and_pd(active[v], n_re), _mm_andnot_pd(active[v], z_re[v]));
+                z_im[v] = _mm_or_pd(_mm_and_pd(active[v], n_im), _mm_andnot_pd(active[v], z_im[v]));
+                counts[v] = _mm_add_pd(counts[v], _mm_and_pd(active[v], one));
+
+                re2[v] = _mm_mul_pd(z_re[v], z_re[v]);
+                im2[v] = _mm_mul_pd(z_im[v], z_im[v]);
+
+                __m128d bounded = _mm_cmple_pd(_mm_add_pd(re2[v], im2[v]), limit);
+                active[v] = _mm_and_pd(active[v], bounded);
+
+                if (save)
+                {
+                    saved_re[v] = z_re[v];
+                    saved_im[v] = z_im[v];
+                }
+                else
+                {
+                    __m128d d_re = _mm_sub_pd(z_re[v], saved_re[v]);
+                    __m128d d_im = _mm_sub_pd(z_im[v], saved_im[v]);
+                    __m128d dist = _mm_add_pd(_mm_mul_pd(d_re, d_re), _mm_mul_pd(d_im, d_im));
+                    __m128d periodic = _mm_and_pd(active[v], _mm_cmplt_pd(dist, tolerance));
+
+                    int caught = _mm_movemask_pd(periodic);
+                    if (caught)
+                    {
+                        stats->cycle_points += mask_popcount(caught);
+                        saved_iterations = _mm_add_pd(saved_iterations, _mm_and_pd(periodic, _mm_sub_pd(max_iterations, counts[v])));
+                        counts[v] = _mm_or_pd(_mm_and_pd(periodic, max_iterations), _mm_andnot_pd(periodic, counts[v]));
+                        active[v] = _mm_andnot_pd(periodic, active[v]);
+                    }
+                }
+            }
+
+            if (save) check_at *= 2;
+        }
+
+        double saved[2];
+        _mm_storeu_pd(saved, saved_iterations);
+        stats->cycle_iterations_saved += (uint64_t)(saved[0] + saved[1]);
+
+        for (int v = 0; v < 2; ++v)
+        {
+            int base = i + v * 2;
+            int left = count - base;
+            if (left <= 0) break;
+
+            int out[4];
+            double magnitude[2];
+            _mm_storeu_si128((__m128i *)out, _mm_cvtpd_epi32(counts[v]));
+            _mm_storeu_pd(magnitude, _mm_add_pd(re2[v], im2[v]));
+            for (int k = 0; k < 2 && k < left; ++k) {
+                iterations[base + k] = out[k];
+                magnitudes[base + k] = (float)magnitude[k];
+            }
+        }
+    }
+}
+
+KERNEL_TARGET("avx2,fma")
+void escape_time_avx2(const escape_params_t *params, const double *re, const double *im, int count, int *iterations, float *magnitudes, escape_stats_t *stats)
+{
+    const __m256d limit = _mm256_set1_pd(4.0);
+    const __m256d one   = _mm256_set1_pd(1.0);
+    const __m256d lanes = _mm256_set_pd(3.0, 2.0, 1.0, 0.0);
+    const __m256d max_iterations = _mm256_set1_pd((double)params->max_iterations);
+    const __m256d tolerance = _mm256_set1_pd(params->cycle_tolerance * params->cycle_tolerance);
+
+    for (int i = 0; i < count; i += 8)
+    {
+        __m256d z_re[2], z_im[2], c_re[2], c_im[2];
+        __m256d re2[2], im2[2], active[2], counts[2];
+        __m256d saved_re[2], saved_im[2];
+        __m256d saved_iterations = _mm256_setzero_pd();
+        int check_at = CYCLE_FIRST_CHECK;
+
+        for (int v = 0; v < 2; ++v)
+        {
+            int base = i + v * 4;
+            int left = count - base;
+
+            __m256d p_re = _mm256_setzero_pd();
+            __m256d p_im = _mm256_setzero_pd();
+            active[v] = _mm256_setzero_pd();
+
+            if (left > 0)
+            {
+                // lanes past the end of the batch are never loaded and never active
+                active[v] = _mm256_cmp_pd(lanes, _mm256_set1_pd((double)left), _CMP_LT_OQ);
+                p_re = _mm256_maskload_pd(re + base, _mm256_castpd_si256(active[v]));
+                p_im = _mm256_maskload_pd(im + base, _mm256_castpd_si256(active[v]));
+            }
+
+            if (params->julia)
+            {
+                z_re[v] = p_re;
+                z_im[v] = p_im;
+                c_re[v] = _mm256_set1_pd(params->julia_re);
+                c_im[v] = _mm256_set1_pd(params->julia_im);
+            }
+            else
+            {
+                z_re[v] = _mm256_setzero_pd();
+                z_im[v] = _mm256_setzero_pd();
+                c_re[v] = p_re;
+                c_im[v] = p_im;
+            }
+
+            re2[v] = _mm256_mul_pd(z_re[v], z_re[v]);
+            im2[v] = _mm256_mul_pd(z_im[v], z_im[v]);
+            counts[v] = _mm256_setzero_pd();
+            saved_re[v] = z_re[v];
+            saved_im[v] = z_im[v];
+
+            if (!params->julia)
+            {
+                __m256d interior = _mm256_and_pd(interior_mask_avx2(c_re[v], c_im[v]), active[v]);
+                active[v] = _mm256_andnot_pd(interior, active[v]);
+                counts[v] = _mm256_and_pd(interior, max_iterations);
+                stats->interior_skipped += mask_popcount(_mm256_movemask_pd(interior));
+            }
+        }
+
+        for (int iteration = 0; iteration < params->max_iterations; ++iteration)
+        {
+            if (_mm256_movemask_pd(_mm256_or_pd(active[0], active[1])) == 0)
+                break;
+
+            bool save = (iteration + 1 == check_at);
+
+            for (int v = 0; v < 2; ++v)
+            {
+                __m256d n_re = _mm256_add_pd(_mm256_sub_pd(re2[v], im2[v]), c_re[v]);
+                __m256d n_im = _mm256_fmadd_pd(_mm256_add_pd(z_re[v], z_re[v]), z_im[v], c_im[v]);
+
+                z_re[v] = _mm256_blendv_pd(z_re[v], n_re, active[v]);
+                z_im[v] = _mm256_blendv_pd(z_im[v], n_im, active[v]);
+                counts[v] = _mm256_add_pd(counts[v], _mm256_and_pd(active[v], one));
+
+                re2[v] = _mm256_mul_pd(z_re[v], z_re[v]);
+                im2[v] = _mm256_mul_pd(z_im[v], z_im[v]);
+
+                __m256d bounded = _mm256_cmp_pd(_mm256_add_pd(re2[v], im2[v]), limit, _CMP_LE_OQ);
+                active[v] = _mm256_and_pd(active[v], bounded);
+
+                if (save)
+                {
+                    saved_re[v] = z_re[v];
+                    saved_im[v] = z_im[v];
+                }
+                else
+                {
+                    __m256d d_re = _mm256_sub_pd(z_re[v], saved_re[v]);
+                    __m256d d_im = _mm256_sub_pd(z_im[v], saved_im[v]);
+                    __m256d dist = _mm256_fmadd_pd(d_re, d_re, _mm256_mul_pd(d_im, d_im));
+                    __m256d periodic = _mm256_and_pd(active[v], _mm256_cmp_pd(dist, tolerance, _CMP_LT_OQ));
+
+                    int caught = _mm256_movemask_pd(periodic);
+                    if (caught)
+                    {
+                        stats->cycle_points += mask_popcount(caught);
+                        saved_iterations = _mm256_add_pd(saved_iterations, _mm256_and_pd(periodic, _mm256_sub_pd(max_iterations, counts[v])));
+                        counts[v] = _mm256_blendv_pd(counts[v], max_iterations, periodic);
+                        active[v] = _mm256_andnot_pd(periodic, active[v]);
+                    }
+                }
+            }
+
+            if (save) check_at *= 2;
+        }
+
+        double saved[4];
+        _mm256_storeu_pd(saved, saved_iterations);
+        stats->cycle_iterations_saved += (uint64_t)(saved[0] + saved[1] + saved[2] + saved[3]);
+
+        for (int v = 0; v < 2; ++v)
+        {
+            int base = i + v * 4;
+            int left = count - base;
+            if (left <= 0) break;
+
+            int out[4];
+            float magnitude[4];
+            _mm_storeu_si128((__m128i *)out, _mm256_cvtpd_epi32(counts[v]));
+            _mm_storeu_ps(magnitude, _mm256_cvtpd_ps(_mm256_add_pd(re2[v], im2[v])));
+            for (int k = 0; k < 4 && k < left; ++k) {
+                iterations[base + k] = out[k];
+                magnitudes[base + k] = magnitude[k];
+            }
+        }
+    }
+}
+
+KERNEL_TARGET("avx512f")
+void escape_time_avx512(const escape_params_t *params, const double *re, const double *im, int count, int *iterations, float *magnitudes, escape_stats_t *stats)
+{
+    const __m512d limit = _mm512_set1_pd(4.0);
+    const __m512d one   = _mm512_set1_pd(1.0);
+    const __m512d max_iterations = _mm512_set1_pd((double)params->max_iterations);
+    const __m512d tolerance = _mm512_set1_pd(params->cycle_tolerance * params->cycle_tolerance);
+
+    for (int i = 0; i < count; i += 16)
+    {
+        __m512d z_re[2], z_im[2], c_re[2], c_im[2];
+        __m512d re2[2], im2[2], counts[2];
+        __m512d saved_re[2], saved_im[2];
+        __m512d saved_iterations = _mm512_setzero_pd();
+        int check_at = CYCLE_FIRST_CHECK;
+        __mmask8 active[2];
+
+        for (int v = 0; v < 2; ++v)
+        {
+            int base = i + v * 8;
+            int left = count - base;
+
+            __m512d p_re = _mm512_setzero_pd();
+            __m512d p_im = _mm512_setzero_pd();
+            active[v] = 0;
+
+            if (left > 0)
+            {
+                active[v] = (left >= 8) ? 0xFF : (__mmask8)((1u << left) - 1);
+                p_re = _mm512_maskz_loadu_pd(active[v], re + base);
+                p_im = _mm512_maskz_loadu_pd(active[v], im + base);
+            }
+
+            if (params->julia)
+            {
+                z_re[v] = p_re;
+                z_im[v] = p_im;
+                c_re[v] = _mm512_set1_pd(params->julia_re);
+                c_im[v] = _mm512_set1_pd(params->julia_im);
+            }
+            else
+            {
+                z_re[v] = _mm512_setzero_pd();
+                z_im[v] = _mm512_setzero_pd();
+                c_re[v] = p_re;
+                c_im[v] = p_im;
+            }
+
+            re2[v] = _mm512_mul_pd(z_re[v], z_re[v]);
+            im2[v] = _mm512_mul_pd(z_im[v], z_im[v]);
+            counts[v] = _mm512_setzero_pd();
+            saved_re[v] = z_re[v];
+            saved_im[v] = z_im[v];
+
+            if (!params->julia)
+            {
+                __mmask8 interior = interior_mask_avx512(c_re[v], c_im[v]) & active[v];
+                active[v] &= (__mmask8)~interior;
+                counts[v] = _mm512_maskz_mov_pd(interior, max_iterations);
+                stats->interior_skipped += mask_popcount(interior);
+            }
+        }
+
+        for (int iteration = 0; iteration < params->max_iterations; ++iteration)
+        {
+            if ((active[0] | active[1]) == 0)
+                break;
+
+            bool save = (iteration + 1 == check_at);
+
+            for (int v = 0; v < 2; ++v)
+            {
+                __m512d n_re = _mm512_add_pd(_mm512_sub_pd(re2[v], im2[v]), c_re[v]);
+                __m512d n_im = _mm512_fmadd_pd(_mm512_add_pd(z_re[v], z_re[v]), z_im[v], c_im[v]);
+
+                z_re[v] = _mm512_mask_mov_pd(z_re[v], active[v], n_re);
+                z_im[v] = _mm512_mask_mov_pd(z_im[v], active[v], n_im);
+                counts[v] = _mm512_mask_add_pd(counts[v], active[v], counts[v], one);
+
+                re2[v] = _mm512_mul_pd(z_re[v], z_re[v]);
+                im2[v] = _mm512_mul_pd(z_im[v], z_im[v]);
+
+                active[v] = _mm512_mask_cmp_pd_mask(active[v], _mm512_add_pd(re2[v], im2[v]), limit, _CMP_LE_OQ);
+
+                if (save)
+                {
+                    saved_re[v] = z_re[v];
+                    saved_im[v] = z_im[v];
+                }
+                else
+                {
+                    __m512d d_re = _mm512_sub_pd(z_re[v], saved_re[v]);
+                    __m512d d_im = _mm512_sub_pd(z_im[v], saved_im[v]);
+                    __m512d dist = _mm512_fmadd_pd(d_re, d_re, _mm512_mul_pd(d_im, d_im));
+                    __mmask8 periodic = _mm512_mask_cmp_pd_mask(active[v], dist, tolerance, _CMP_LT_OQ);
+
+                    if (periodic)
+                    {
+                        stats->cycle_points += mask_popcount(periodic);
+                        saved_iterations = _mm512_mask_add_pd(saved_iterations, periodic, saved_iterations, _mm512_sub_pd(max_iterations, counts[v]));
+                        counts[v] = _mm512_mask_mov_pd(counts[v], periodic, max_iterations);
+                        active[v] &= (__mmask8)~periodic;
+                    }
+                }
+            }
+
+            if (save) check_at *= 2;
+        }
+
+        stats->cycle_iterations_saved += (uint64_t)_mm512_reduce_add_pd(saved_iterations);
+
+        for (int v = 0; v < 2; ++v)
+        {
+            int base = i + v * 8;
+            int left = count - base;
+            if (left <= 0) break;
+
+            int out[8];
+            float magnitude[8];
+            _mm256_storeu_si256((__m256i *)out, _mm512_cvtpd_epi32(counts[v]));
+            _mm256_storeu_ps(magnitude, _mm512_cvtpd_ps(_mm512_add_pd(re2[v], im2[v])));
+            for (int k = 0; k < 8 && k < left; ++k) {
+                iterations[base + k] = out[k];
+                magnitudes[base + k] = magnitude[k];
+            }
+        }
+    }
+}
+#endif
+
+static const char *g_precision_names[PRECISION_COUNT] = { "float32", "double", "double-double", "perturbation", "extended", "direct hp" };
+
+const char *precision_name(precision_t precision)
+{
+    return (precision < PRECISION_COUNT) ? g_precision_names[precision] : "unknown";
+}
+
+precision_t precision_for_spacing(double scale, double magnitude)
+{
+    // rounding of a value near "magnitude", the unit roundoff of each type
+    double reach = (magnitude > 2.0) ? magnitude : 2.0;
+
+    if (scale >= reach * 5.96e-8 * FLOAT_PRECISION_MARGIN) return PRECISION_FLOAT;
+    if (scale >= reach * 1.11e-16 * PRECISION_MARGIN) return PRECISION_DOUBLE;
+    return PRECISION_DOUBLE_DOUBLE;
+}
+
+static const char *g_isa_names[KERNEL_COUNT] = { "scalar", "sse2", "avx2", "avx512" };
+
+const char *kernels_isa_name(kernel_isa_t isa)
+{
+    return (isa < KERNEL_COUNT) ? g_isa_names[isa] : "unknown";
+}
+
+bool kernels_isa_supported(kernel_isa_t isa)
+{
+    cpu_features_t cpu = get_cpu_features();
+
+    switch (isa)
+    {
+        case KERNEL_SCALAR: return true;
+        #if KERNELS_X86
+            case KERNEL_SSE2:   return cpu.sse2;
+            case KERNEL_AVX2:   return cpu.avx2 && cpu.fma;
+            case KERNEL_AVX512: return cpu.avx512f;
+        #endif
+        default: return false;
+    }
+}
+
+static escape_time_func_t kernels_escape_time_for(kernel_isa_t isa)
+{
+    switch (isa)
+    {
+        #if KERNELS_X86
+            case KERNEL_SSE2:   return escape_time_sse2;
+            case KERNEL_AVX2:   return escape_time_avx2;
+            case KERNEL_AVX512: return escape_time_avx512;
+        #endif
+        default: return escape_time_scalar;
+    }
+}
+
+static escape_time_float_func_t kernels_escape_time_float_for(kernel_isa_t isa)
+{
+    switch (isa)
+    {
+        #if KERNELS_X86
+            case KERNEL_SSE2:   return escape_time_float_sse2;
+            case KERNEL_AVX2:   return escape_time_float_avx2;
+            case KERNEL_AVX512: return escape_time_float_avx512;
+        #endif
+        default: return escape_time_float_scalar;
+    }
+}
+
+static escape_time_dd_func_t kernels_escape_time_dd_for(kernel_isa_t isa)
+{
+    switch (isa)
+    {
+        #if KERNELS_X86
+            case KERNEL_AVX2:   return escape_time_dd_avx2;
+            case KERNEL_AVX512: return escape_time_dd_avx512;
+        #endif
+        default: return escape_time_dd_scalar;
+    }
+}
+
+/*
+    Runs once from app_init (and again after a reload since the table lives in the dll),
+    anything the host cannot run is never bound so the same binary works everywhere.
+ */
+void kernels_init(void)
+{
+    kernel_isa_t best = KERNEL_SCALAR;
+    for (int isa = KERNEL_SCALAR; isa < KERNEL_COUNT; ++isa) {
+        if (kernels_isa_supported((kernel_isa_t)isa)) {
+            best = (kernel_isa_t)isa;
+        }
+    }
+
+    kernel_isa_t chosen = best;
+
+    const char *override = getenv("MANDELBROT_KERNEL");
+    if (override && override[0])
+    {
+        int requested = -1;
+        for (int isa = KERNEL_SCALAR; isa < KERNEL_COUNT; ++isa) {
+            if (strcmp(override, g_isa_names[isa]) == 0) {
+                requested = isa;
+            }
+        }
+
+        if (requested < 0) {
+            printf("[CPU] Unknown MANDELBROT_KERNEL=%s, using %s\n", override, kernels_isa_name(best));
+        } else if (!kernels_isa_supported((kernel_isa_t)requested)) {
+            printf("[CPU] %s not supported on this machine, using %s\n", override, kernels_isa_name(best));
+        } else {
+            chosen = (kernel_isa_t)requested;
+        }
+    }
+
+    g_kernels.isa = chosen;
+    g_kernels.name = kernels_isa_name(chosen);
+    g_kernels.escape_time = kernels_escape_time_for(chosen);
+    g_kernels.escape_time_float = kernels_escape_time_float_for(chosen);
+    g_kernels.escape_time_dd = kernels_escape_time_dd_for(chosen);
+
+    printf("[CPU] Escape-time kernel: %s\n", g_kernels.name);
+}
@@ -0,0 +1,208 @@
+#ifndef KERNELS_H_
+#define KERNELS_H_
+
+#include <stdint.h>
+#include <stdbool.h>
+
+#if defined(__x86_64__) || defined(_M_X64) || defined(__i386__) || defined(_M_IX86)
+    #define KERNELS_X86 1
+    #include <immintrin.h>
+#else
+    #define KERNELS_X86 0
+#endif
+
+/*
+    Every variant is compiled into the same binary regardless of the /arch or -m flags,
+    gcc/clang need to be told per function which instructions they may emit,
+    msvc lets us use any intrinsic anywhere.
+ */
+#if KERNELS_X86 && (defined(__GNUC__) || defined(__clang__))
+    #define KERNEL_TARGET(isa) __attribute__((target(isa)))
+#else
+    #define KERNEL_TARGET(isa)
+#endif
+
+/*
+    Escape-time kernels, they all take a batch of points and write how many
+    iterations each point survived before leaving the escape radius, and |z|^2 at
+    the iteration it stopped on (just past the radius for the ones that escaped),
+    which is all the smooth colouring needs on top of the count.
+
+    For the mandelbrot set the points are the "c" values and z starts at 0,
+    for the julia set the points are the starting z and "c" is fixed.
+ */
+#define ESCAPE_BATCH 64
+
+/*
+    The cheapest number type that still resolves the pixel spacing is picked per tile,
+    a type is good enough while its rounding near the values being iterated stays
+    PRECISION_MARGIN times finer than a pixel (a dozen bits, a double runs out around
+    1e-12 for the usual |z| <= 2).
+    Floats get a few more bits of margin, with so few to start with the errors reach
+    the iteration counts of the deeper pixels well before the spacing does, so they are
+    only used for the views around the whole set.
+    Past double-double it is up to the caller, perturbation from DEEP_ZOOM_SCALE (perturb.h)
+    with floatexp deltas from EXTENDED_SCALE, or direct high precision iteration.
+ */
+#define PRECISION_MARGIN 4096.0
+#define FLOAT_PRECISION_MARGIN 16384.0
+
+typedef enum
+{
+    PRECISION_FLOAT,
+    PRECISION_DOUBLE,
+    PRECISION_DOUBLE_DOUBLE,
+    PRECISION_PERTURBATION,
+    PRECISION_EXTENDED,         // perturbation with floatexp deltas, past EXTENDED_SCALE
+    PRECISION_DIRECT_HP,
+    PRECISION_COUNT
+} precision_t;
+
+/* magnitude is the largest |coordinate| in the tile, never taken below the escape radius */
+precision_t precision_for_spacing(double scale, double magnitude);
+const char *precision_name(precision_t precision);
+
+typedef struct
+{
+    int max_iterations;
+
+    bool julia;
+    double julia_re;
+    double julia_im;
+
+    /*
+        Periodicity checking (Brent): z is saved at iterations 8, 16, 32 ... and every
+        iteration in between is compared against it, an orbit that comes back within
+        the tolerance is caught in a cycle and will never escape.
+        Should be well below the pixel spacing, 0 turns the check off.
+     */
+    double cycle_tolerance;
+} escape_params_t;
+
+#define CYCLE_FIRST_CHECK 8
+
+/* Tolerance relative to the pixel spacing, small enough that no escaping pixel is ever caught */
+#define CYCLE_TOLERANCE_SCALE 1e-4
+
+/*
+    Work the kernels avoided, accumulated (+=) so a caller can sum a whole tile or frame
+ */
+typedef struct
+{
+    uint64_t interior_skipped;          // points classified by the cardioid / bulb test without iterating
+    uint64_t cycle_points;              // points stopped early by the periodicity check
+    uint64_t cycle_iterations_saved;    // iterations those points would have run up to max_iterations
+    uint64_t rebases;                   // deep zoom, pixel orbits moved back to the start of the reference
+    uint64_t bla_iterations_skipped;    // deep zoom, iterations covered by linear approximation steps
+} escape_stats_t;
+
+typedef void (*escape_time_func_t)(const escape_params_t *params, const double *re, const double *im, int count, int *iterations, float *magnitudes, escape_stats_t *stats);
+
+/*
+    Single precision variants (kernels_float.c), for the shallow zooms where a float
+    is enough and a register holds twice the points.
+
+    Double-double variants (kernels_dd.c), the points come in as hi + lo pairs for
+    ~106 bits of mantissa, enough to go a good way past where a plain double
+    runs out for a fraction of the bignum cost.
+ */
+typedef void (*escape_time_float_func_t)(const escape_params_t *params, const float *re, const float *im, int count, int *iterations, float *magnitudes, escape_stats_t *stats);
+
+typedef void (*escape_time_dd_func_t)(const escape_params_t *params, const double *re_hi, const double *re_lo, const double *im_hi, const double *im_lo,
+                                      int count, int *iterations, float *magnitudes, escape_stats_t *stats);
+
+typedef enum
+{
+    KERNEL_SCALAR,
+    KERNEL_SSE2,
+    KERNEL_AVX2,
+    KERNEL_AVX512,
+    KERNEL_COUNT
+} kernel_isa_t;
+
+/*
+    The kernels the renderers call, bound once by kernels_init()
+ */
+typedef struct
+{
+    kernel_isa_t isa;
+    const char *name;
+    escape_time_func_t escape_time;
+    escape_time_float_func_t escape_time_float;
+    escape_time_dd_func_t escape_time_dd;
+} kernel_table_t;
+
+extern kernel_table_t g_kernels;
+
+void escape_time_scalar(const escape_params_t *params, const double *re, const double *im, int count, int *iterations, float *magnitudes, escape_stats_t *stats);
+
+#if KERNELS_X86
+void escape_time_sse2(const escape_params_t *params, const double *re, const double *im, int count, int *iterations, float *magnitudes, escape_stats_t *stats);
+void escape_time_avx2(const escape_params_t *params, const double *re, const double *im, int count, int *iterations, float *magnitudes, escape_stats_t *stats);
+void escape_time_avx512(const escape_params_t *params, const double *re, const double *im, int count, int *iterations, float *magnitudes, escape_stats_t *stats);
+#endif
+
+void escape_time_float_scalar(const escape_params_t *params, const float *re, const float *im, int count, int *iterations, float *magnitudes, escape_stats_t *stats);
+
+#if KERNELS_X86
+void escape_time_float_sse2(const escape_params_t *params, const float *re, const float *im, int count, int *iterations, float *magnitudes, escape_stats_t *stats);
+void escape_time_float_avx2(const escape_params_t *params, const float *re, const float *im, int count, int *iterations, float *magnitudes, escape_stats_t *stats);
+void escape_time_float_avx512(const escape_params_t *params, const float *re, const float *im, int count, int *iterations, float *magnitudes, escape_stats_t *stats);
+#endif
+
+void escape_time_dd_scalar(const escape_params_t *params, const double *re_hi, const double *re_lo, const double *im_hi, const double *im_lo,
+                           int count, int *iterations, float *magnitudes, escape_stats_t *stats);
+
+#if KERNELS_X86
+// no sse2 version, without an fma the products cost too much to beat the scalar one by much
+void escape_time_dd_avx2(const escape_params_t *params, const double *re_hi, const double *re_lo, const double *im_hi, const double *im_lo,
+                         int count, int *iterations, float *magnitudes, escape_stats_t *stats);
+void escape_time_dd_avx512(const escape_params_t *params, const double *re_hi, const double *re_lo, const double *im_hi, const double *im_lo,
+                           int count, int *iterations, float *magnitudes, escape_stats_t *stats);
+#endif
+
+/* hi + lo = center + offset[i], rounded once */
+void dd_offset_points(double center_hi, double center_lo, const double *offset, int count, double *hi, double *lo);
+
+/*
+    Picks the widest variant the cpu and OS support, "MANDELBROT_KERNEL"
+    (scalar, sse2, avx2, avx512) in the environment overrides the choice.
+ */
+void kernels_init(void);
+bool kernels_isa_supported(kernel_isa_t isa);
+const char *kernels_isa_name(kernel_isa_t isa);
+
+/*
+    Closed form membership for the two biggest components of the mandelbrot set,
+    a point inside either never escapes so there is nothing to iterate:
+    - main cardioid : q * (q + (x - 1/4)) <= y^2 / 4 where q = (x - 1/4)^2 + y^2
+    - period-2 bulb : (x + 1)^2 + y^2 <= 1/16
+ */
+static inline bool in_main_cardioid_or_bulb(double x, double y)
+{
+    double y2 = y * y;
+    double xq = x - 0.25;
+    double q = xq * xq + y2;
+    if (q * (q + xq) <= 0.25 * y2) return true;
+
+    double xb = x + 1.0;
+    return xb * xb + y2 <= 0.0625;
+}
+
+static inline void escape_time(const escape_params_t *params, const double *re, const double *im, int count, int *iterations, float *magnitudes, escape_stats_t *stats)
+{
+    g_kernels.escape_time(params, re, im, count, iterations, magnitudes, stats);
+}
+
+static inline void escape_time_float(const escape_params_t *params, const float *re, const float *im, int count, int *iterations, float *magnitudes, escape_stats_t *stats)
+{
+    g_kernels.escape_time_float(params, re, im, count, iterations, magnitudes, stats);
+}
+
+static inline void escape_time_dd(const escape_params_t *params, const double *re_hi, const double *re_lo, const double *im_hi, const double *im_lo,
+                                  int count, int *iterations, float *magnitudes, escape_stats_t *stats)
+{
+    g_kernels.escape_time_dd(params, re_hi, re_lo, im_hi, im_lo, count, iterations, magnitudes, stats);
+}
+
+#endif
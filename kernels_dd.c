@@ -0,0 +1,457 @@
+#include "kernels.h"
+
+/*
+    Double-double kernels, every value is an unevaluated sum hi + lo with |lo| <= ulp(hi) / 2,
+    which gives ~106 bits of mantissa for a handful of extra flops per operation.
+
+    Everything here is built on the error free transforms :
+    - two_sum  : s + e == a + b exactly
+    - two_prod : p + e == a * b exactly, one fma (fma(a, b, -p) is exactly the rounding error)
+
+    They only hold if the compiler does not reassociate, the msvc build uses /fp:fast.
+ */
+#if defined(_MSC_VER) && !defined(__clang__)
+    #pragma float_control(precise, on, push)
+    #pragma fp_contract(off)
+#endif
+
+static inline void two_sum(double a, double b, double *s, double *e)
+{
+    *s = a + b;
+    double bb = *s - a;
+    *e = (a - (*s - bb)) + (b - bb);
+}
+
+// only when |a| >= |b|
+static inline void fast_two_sum(double a, double b, double *s, double *e)
+{
+    *s = a + b;
+    *e = b - (*s - a);
+}
+
+/*
+    The scalar kernel cannot count on an fma, Dekker's split cuts each factor into two
+    26 bit halves whose products are exact instead.
+ */
+static inline void split(double a, double *hi, double *lo)
+{
+    double t = 134217729.0 * a;     // 2^27 + 1
+    *hi = t - (t - a);
+    *lo = a - *hi;
+}
+
+static inline void two_prod(double a, double b, double *p, double *e)
+{
+    double a_hi, a_lo, b_hi, b_lo;
+    split(a, &a_hi, &a_lo);
+    split(b, &b_hi, &b_lo);
+
+    *p = a * b;
+    *e = ((a_hi * b_hi - *p) + a_hi * b_lo + a_lo * b_hi) + a_lo * b_lo;
+}
+
+static inline void dd_add(double a_hi, double a_lo, double b_hi, double b_lo, double *r_hi, double *r_lo)
+{
+    double s, e;
+    two_sum(a_hi, b_hi, &s, &e);
+    e += a_lo + b_lo;
+    fast_two_sum(s, e, r_hi, r_lo);
+}
+
+static inline void dd_mul(double a_hi, double a_lo, double b_hi, double b_lo, double *r_hi, double *r_lo)
+{
+    double p, e;
+    two_prod(a_hi, b_hi, &p, &e);
+    e += a_hi * b_lo + a_lo * b_hi;
+    fast_two_sum(p, e, r_hi, r_lo);
+}
+
+void dd_offset_points(double center_hi, double center_lo, const double *offset, int count, double *hi, double *lo)
+{
+    for (int i = 0; i < count; ++i) {
+        dd_add(center_hi, center_lo, offset[i], 0.0, &hi[i], &lo[i]);
+    }
+}
+
+void escape_time_dd_scalar(const escape_params_t *params, const double *re_hi, const double *re_lo, const double *im_hi, const double *im_lo,
+                           int count, int *iterations, float *magnitudes, escape_stats_t *stats)
+{
+    const double limit = 4.0;
+    const double tolerance = params->cycle_tolerance * params->cycle_tolerance;
+
+    for (int i = 0; i < count; ++i)
+    {
+        if (!params->julia && in_main_cardioid_or_bulb(re_hi[i], im_hi[i]))
+        {
+            iterations[i] = params->max_iterations;
+            magnitudes[i] = 0.0f;
+            stats->interior_skipped++;
+            continue;
+        }
+
+        double z_re = params->julia ? re_hi[i] : 0.0, z_re_lo = params->julia ? re_lo[i] : 0.0;
+        double z_im = params->julia ? im_hi[i] : 0.0, z_im_lo = params->julia ? im_lo[i] : 0.0;
+        double c_re = params->julia ? params->julia_re : re_hi[i], c_re_lo = params->julia ? 0.0 : re_lo[i];
+        double c_im = params->julia ? params->julia_im : im_hi[i], c_im_lo = params->julia ? 0.0 : im_lo[i];
+
+        int iteration = 0;
+
+        double saved_re = z_re, saved_re_lo = z_re_lo;
+        double saved_im = z_im, saved_im_lo = z_im_lo;
+        int check_at = CYCLE_FIRST_CHECK;
+        bool periodic = false;
+
+        while (iteration < params->max_iterations)
+        {
+            double re2, re2_lo, im2, im2_lo, re_im, re_im_lo;
+            dd_mul(z_re, z_re_lo, z_re, z_re_lo, &re2, &re2_lo);
+            dd_mul(z_im, z_im_lo, z_im, z_im_lo, &im2, &im2_lo);
+            dd_mul(z_re, z_re_lo, z_im, z_im_lo, &re_im, &re_im_lo);
+
+            dd_add(re2, re2_lo, -im2, -im2_lo, &z_re, &z_re_lo);
+            dd_add(z_re, z_re_lo, c_re, c_re_lo, &z_re, &z_re_lo);
+
+            // doubling is exact
+            dd_add(2.0 * re_im, 2.0 * re_im_lo, c_im, c_im_lo, &z_im, &z_im_lo);
+            iteration++;
+
+            if (z_re*z_re + z_im*z_im > limit)
+                break;
+
+            if (iteration == check_at)
+            {
+                saved_re = z_re; saved_re_lo = z_re_lo;
+                saved_im = z_im; saved_im_lo = z_im_lo;
+                check_at *= 2;
+            }
+            else
+            {
+                double d_re = (z_re - saved_re) + (z_re_lo - saved_re_lo);
+                double d_im = (z_im - saved_im) + (z_im_lo - saved_im_lo);
+                if (d_re*d_re + d_im*d_im < tolerance) {
+                    periodic = true;
+                    break;
+                }
+            }
+        }
+
+        if (periodic)
+        {
+            stats->cycle_points++;
+            stats->cycle_iterations_saved += params->max_iterations - iteration;
+            iteration = params->max_iterations;
+        }
+
+        iterations[i] = iteration;
+        magnitudes[i] = (float)(z_re*z_re + z_im*z_im);
+    }
+}
+
+/*
+    Same lockstep scheme as the double kernels, one register per step though, the
+    three products of an iteration are independent so there is enough to overlap
+    without interleaving a second one (and not enough registers for it anyway).
+ */
+#if KERNELS_X86
+
+KERNEL_TARGET("avx2,fma")
+static inline void two_sum_avx2(__m256d a, __m256d b, __m256d *s, __m256d *e)
+{
+    *s = _mm256_add_pd(a, b);
+    __m256d bb = _mm256_sub_pd(*s, a);
+    *e = _mm256_add_pd(_mm256_sub_pd(a, _mm256_sub_pd(*s, bb)), _mm256_sub_pd(b, bb));
+}
+
+KERNEL_TARGET("avx2,fma")
+static inline void fast_two_sum_avx2(__m256d a, __m256d b, __m256d *s, __m256d *e)
+{
+    *s = _mm256_add_pd(a, b);
+    *e = _mm256_sub_pd(b, _mm256_sub_pd(*s, a));
+}
+
+KERNEL_TARGET("avx2,fma")
+static inline void dd_add_avx2(__m256d a_hi, __m256d a_lo, __m256d b_hi, __m256d b_lo, __m256d *r_hi, __m256d *r_lo)
+{
+    __m256d s, e;
+    two_sum_avx2(a_hi, b_hi, &s, &e);
+    e = _mm256_add_pd(e, _mm256_add_pd(a_lo, b_lo));
+    fast_two_sum_avx2(s, e, r_hi, r_lo);
+}
+
+KERNEL_TARGET("avx2,fma")
+static inline void dd_mul_avx2(__m256d a_hi, __m256d a_lo, __m256d b_hi, __m256d b_lo, __m256d *r_hi, __m256d *r_lo)
+{
+    __m256d p = _mm256_mul_pd(a_hi, b_hi);
+    __m256d e = _mm256_fmsub_pd(a_hi, b_hi, p);
+    e = _mm256_fmadd_pd(a_hi, b_lo, e);
+    e = _mm256_fmadd_pd(a_lo, b_hi, e);
+    fast_two_sum_avx2(p, e, r_hi, r_lo);
+}
+
+KERNEL_TARGET("avx2,fma")
+static inline __m256d blend_avx2(__m256d mask, __m256d a, __m256d b)
+{
+    return _mm256_blendv_pd(b, a, mask);
+}
+
+KERNEL_TARGET("avx2,fma")
+void escape_time_dd_avx2(const escape_params_t *params, const double *re_hi, const double *re_lo, const double *im_hi, const double *im_lo,
+                         int count, int *iterations, float *magnitudes, escape_stats_t *stats)
+{
+    const __m256d limit = _mm256_set1_pd(4.0);
+    const __m256d one   = _mm256_set1_pd(1.0);
+    const __m256d lanes = _mm256_set_pd(3.0, 2.0, 1.0, 0.0);
+    const __m256d max_iterations = _mm256_set1_pd((double)params->max_iterations);
+    const __m256d tolerance = _mm256_set1_pd(params->cycle_tolerance * params->cycle_tolerance);
+
+    for (int i = 0; i < count; i += 4)
+    {
+        int left = count - i;
+
+        // lanes past the end of the batch are never loaded and never active
+        __m256d active = _mm256_cmp_pd(lanes, _mm256_set1_pd((double)left), _CMP_LT_OQ);
+        __m256i load = _mm256_castpd_si256(active);
+
+        __m256d p_re = _mm256_maskload_pd(re_hi + i, load), p_re_lo = _mm256_maskload_pd(re_lo + i, load);
+        __m256d p_im = _mm256_maskload_pd(im_hi + i, load), p_im_lo = _mm256_maskload_pd(im_lo + i, load);
+
+        __m256d z_re, z_re_lo, z_im, z_im_lo, c_re, c_re_lo, c_im, c_im_lo;
+
+        if (params->julia)
+        {
+            z_re = p_re; z_re_lo = p_re_lo;
+            z_im = p_im; z_im_lo = p_im_lo;
+            c_re = _mm256_set1_pd(params->julia_re); c_re_lo = _mm256_setzero_pd();
+            c_im = _mm256_set1_pd(params->julia_im); c_im_lo = _mm256_setzero_pd();
+        }
+        else
+        {
+            z_re = z_re_lo = z_im = z_im_lo = _mm256_setzero_pd();
+            c_re = p_re; c_re_lo = p_re_lo;
+            c_im = p_im; c_im_lo = p_im_lo;
+        }
+
+        __m256d counts = _mm256_setzero_pd();
+        __m256d saved_iterations = _mm256_setzero_pd();
+        __m256d saved_re = z_re, saved_re_lo = z_re_lo;
+        __m256d saved_im = z_im, saved_im_lo = z_im_lo;
+        int check_at = CYCLE_FIRST_CHECK;
+
+        if (!params->julia)
+        {
+            __m256d interior = _mm256_and_pd(interior_mask_avx2(c_re, c_im), active);
+            active = _mm256_andnot_pd(interior, active);
+            counts = _mm256_and_pd(interior, max_iterations);
+            stats->interior_skipped += mask_popcount(_mm256_movemask_pd(interior));
+        }
+
+        for (int iteration = 0; iteration < params->max_iterations; ++iteration)
+        {
+            if (_mm256_movemask_pd(active) == 0)
+                break;
+
+            __m256d re2, re2_lo, im2, im2_lo, re_im, re_im_lo;
+            dd_mul_avx2(z_re, z_re_lo, z_re, z_re_lo, &re2, &re2_lo);
+            dd_mul_avx2(z_im, z_im_lo, z_im, z_im_lo, &im2, &im2_lo);
+            dd_mul_avx2(z_re, z_re_lo, z_im, z_im_lo, &re_im, &re_im_lo);
+
+            __m256d n_re, n_re_lo, n_im, n_im_lo;
+            dd_add_avx2(re2, re2_lo, _mm256_sub_pd(_mm256_setzero_pd(), im2), _mm256_sub_pd(_mm256_setzero_pd(), im2_lo), &n_re, &n_re_lo);
+            dd_add_avx2(n_re, n_re_lo, c_re, c_re_lo, &n_re, &n_re_lo);
+            dd_add_avx2(_mm256_add_pd(re_im, re_im), _mm256_add_pd(re_im_lo, re_im_lo), c_im, c_im_lo, &n_im, &n_im_lo);
+
+            z_re = blend_avx2(active, n_re, z_re); z_re_lo = blend_avx2(active, n_re_lo, z_re_lo);
+            z_im = blend_avx2(active, n_im, z_im); z_im_lo = blend_avx2(active, n_im_lo, z_im_lo);
+            counts = _mm256_add_pd(counts, _mm256_and_pd(active, one));
+
+            __m256d magnitude = _mm256_fmadd_pd(z_re, z_re, _mm256_mul_pd(z_im, z_im));
+            active = _mm256_and_pd(active, _mm256_cmp_pd(magnitude, limit, _CMP_LE_OQ));
+
+            if (iteration + 1 == check_at)
+            {
+                saved_re = z_re; saved_re_lo = z_re_lo;
+                saved_im = z_im; saved_im_lo = z_im_lo;
+                check_at *= 2;
+            }
+            else
+            {
+                __m256d d_re = _mm256_add_pd(_mm256_sub_pd(z_re, saved_re), _mm256_sub_pd(z_re_lo, saved_re_lo));
+                __m256d d_im = _mm256_add_pd(_mm256_sub_pd(z_im, saved_im), _mm256_sub_pd(z_im_lo, saved_im_lo));
+                __m256d dist = _mm256_fmadd_pd(d_re, d_re, _mm256_mul_pd(d_im, d_im));
+                __m256d periodic = _mm256_and_pd(active, _mm256_cmp_pd(dist, tolerance, _CMP_LT_OQ));
+
+                int caught = _mm256_movemask_pd(periodic);
+                if (caught)
+                {
+                    stats->cycle_points += mask_popcount(caught);
+                    saved_iterations = _mm256_add_pd(saved_iterations, _mm256_and_pd(periodic, _mm256_sub_pd(max_iterations, counts)));
+                    counts = blend_avx2(periodic, max_iterations, counts);
+                    active = _mm256_andnot_pd(periodic, active);
+                }
+            }
+        }
+
+        double saved[4];
+        _mm256_storeu_pd(saved, saved_iterations);
+        stats->cycle_iterations_saved += (uint64_t)(saved[0] + saved[1] + saved[2] + saved[3]);
+
+        int out[4];
+        float magnitude[4];
+        _mm_storeu_si128((__m128i *)out, _mm256_cvtpd_epi32(counts));
+        _mm_storeu_ps(magnitude, _mm256_cvtpd_ps(_mm256_fmadd_pd(z_re, z_re, _mm256_mul_pd(z_im, z_im))));
+        for (int k = 0; k < 4 && k < left; ++k) {
+            iterations[i + k] = out[k];
+            magnitudes[i + k] = magnitude[k];
+        }
+    }
+}
+
+KERNEL_TARGET("avx512f")
+static inline void two_sum_avx512(__m512d a, __m512d b, __m512d *s, __m512d *e)
+{
+    *s = _mm512_add_pd(a, b);
+    __m512d bb = _mm512_sub_pd(*s, a);
+    *e = _mm512_add_pd(_mm512_sub_pd(a, _mm512_sub_pd(*s, bb)), _mm512_sub_pd(b, bb));
+}
+
+KERNEL_TARGET("avx512f")
+static inline void fast_two_sum_avx512(__m512d a, __m512d b, __m512d *s, __m512d *e)
+{
+    *s = _mm512_add_pd(a, b);
+    *e = _mm512_sub_pd(b, _mm512_sub_pd(*s, a));
+}
+
+KERNEL_TARGET("avx512f")
+static inline void dd_add_avx512(__m512d a_hi, __m512d a_lo, __m512d b_hi, __m512d b_lo, __m512d *r_hi, __m512d *r_lo)
+{
+    __m512d s, e;
+    two_sum_avx512(a_hi, b_hi, &s, &e);
+    e = _mm512_add_pd(e, _mm512_add_pd(a_lo, b_lo));
+    fast_two_sum_avx512(s, e, r_hi, r_lo);
+}
+
+KERNEL_TARGET("avx512f")
+static inline void dd_mul_avx512(__m512d a_hi, __m512d a_lo, __m512d b_hi, __m512d b_lo, __m512d *r_hi, __m512d *r_lo)
+{
+    __m512d p = _mm512_mul_pd(a_hi, b_hi);
+    __m512d e = _mm512_fmsub_pd(a_hi, b_hi, p);
+    e = _mm512_fmadd_pd(a_hi, b_lo, e);
+    e = _mm512_fmadd_pd(a_lo, b_hi, e);
+    fast_two_sum_avx512(p, e, r_hi, r_lo);
+}
+
+KERNEL_TARGET("avx512f")
+void escape_time_dd_avx512(const escape_params_t *params, const double *re_hi, const double *re_lo, const double *im_hi, const double *im_lo,
+                           int count, int *iterations, float *magnitudes, escape_stats_t *stats)
+{
+    const __m512d limit = _mm512_set1_pd(4.0);
+    const __m512d one   = _mm512_set1_pd(1.0);
+    const __m512d zero  = _mm512_setzero_pd();
+    const __m512d max_iterations = _mm512_set1_pd((double)params->max_iterations);
+    const __m512d tolerance = _mm512_set1_pd(params->cycle_tolerance * params->cycle_tolerance);
+
+    for (int i = 0; i < count; i += 8)
+    {
+        int left = count - i;
+
+        // lanes past the end of the batch are never loaded and never active
+        __mmask8 active = (left >= 8) ? 0xFF : (__mmask8)((1u << left) - 1);
+
+        __m512d p_re = _mm512_maskz_loadu_pd(active, re_hi + i), p_re_lo = _mm512_maskz_loadu_pd(active, re_lo + i);
+        __m512d p_im = _mm512_maskz_loadu_pd(active, im_hi + i), p_im_lo = _mm512_maskz_loadu_pd(active, im_lo + i);
+
+        __m512d z_re, z_re_lo, z_im, z_im_lo, c_re, c_re_lo, c_im, c_im_lo;
+
+        if (params->julia)
+        {
+            z_re = p_re; z_re_lo = p_re_lo;
+            z_im = p_im; z_im_lo = p_im_lo;
+            c_re = _mm512_set1_pd(params->julia_re); c_re_lo = zero;
+            c_im = _mm512_set1_pd(params->julia_im); c_im_lo = zero;
+        }
+        else
+        {
+            z_re = z_re_lo = z_im = z_im_lo = zero;
+            c_re = p_re; c_re_lo = p_re_lo;
+            c_im = p_im; c_im_lo = p_im_lo;
+        }
+
+        __m512d counts = zero;
+        __m512d saved_iterations = zero;
+        __m512d saved_re = z_re, saved_re_lo = z_re_lo;
+        __m512d saved_im = z_im, saved_im_lo = z_im_lo;
+        int check_at = CYCLE_FIRST_CHECK;
+
+        if (!params->julia)
+        {
+            __mmask8 interior = interior_mask_avx512(c_re, c_im) & active;
+            active &= (__mmask8)~interior;
+            counts = _mm512_maskz_mov_pd(interior, max_iterations);
+            stats->interior_skipped += mask_popcount(interior);
+        }
+
+        for (int iteration = 0; iteration < params->max_iterations; ++iteration)
+        {
+            if (active == 0)
+                break;
+
+            __m512d re2, re2_lo, im2, im2_lo, re_im, re_im_lo;
+            dd_mul_avx512(z_re, z_re_lo, z_re, z_re_lo, &re2, &re2_lo);
+            dd_mul_avx512(z_im, z_im_lo, z_im, z_im_lo, &im2, &im2_lo);
+            dd_mul_avx512(z_re, z_re_lo, z_im, z_im_lo, &re_im, &re_im_lo);
+
+            __m512d n_re, n_re_lo, n_im, n_im_lo;
+            dd_add_avx512(re2, re2_lo, _mm512_sub_pd(zero, im2), _mm512_sub_pd(zero, im2_lo), &n_re, &n_re_lo);
+            dd_add_avx512(n_re, n_re_lo, c_re, c_re_lo, &n_re, &n_re_lo);
+            dd_add_avx512(_mm512_add_pd(re_im, re_im), _mm512_add_pd(re_im_lo, re_im_lo), c_im, c_im_lo, &n_im, &n_im_lo);
+
+            z_re = _mm512_mask_mov_pd(z_re, active, n_re); z_re_lo = _mm512_mask_mov_pd(z_re_lo, active, n_re_lo);
+            z_im = _mm512_mask_mov_pd(z_im, active, n_im); z_im_lo = _mm512_mask_mov_pd(z_im_lo, active, n_im_lo);
+            counts = _mm512_mask_add_pd(counts, active, counts, one);
+
+            __m512d magnitude = _mm512_fmadd_pd(z_re, z_re, _mm512_mul_pd(z_im, z_im));
+            active &= _mm512_cmp_pd_mask(magnitude, limit, _CMP_LE_OQ);
+
+            if (iteration + 1 == check_at)
+            {
+                saved_re = z_re; saved_re_lo = z_re_lo;
+                saved_im = z_im; saved_im_lo = z_im_lo;
+                check_at *= 2;
+            }
+            else
+            {
+                __m512d d_re = _mm512_add_pd(_mm512_sub_pd(z_re, saved_re), _mm512_sub_pd(z_re_lo, saved_re_lo));
+                __m512d d_im = _mm512_add_pd(_mm512_sub_pd(z_im, saved_im), _mm512_sub_pd(z_im_lo, saved_im_lo));
+                __m512d dist = _mm512_fmadd_pd(d_re, d_re, _mm512_mul_pd(d_im, d_im));
+                __mmask8 periodic = _mm512_mask_cmp_pd_mask(active, dist, tolerance, _CMP_LT_OQ);
+
+                if (periodic)
+                {
+                    stats->cycle_points += mask_popcount(periodic);
+                    saved_iterations = _mm512_mask_add_pd(saved_iterations, periodic, saved_iterations, _mm512_sub_pd(max_iterations, counts));
+                    counts = _mm512_mask_mov_pd(counts, periodic, max_iterations);
+                    active &= (__mmask8)~periodic;
+                }
+            }
+        }
+
+        stats->cycle_iterations_saved += (uint64_t)_mm512_reduce_add_pd(saved_iterations);
+
+        int out[8];
+        float magnitude[8];
+        _mm256_storeu_si256((__m256i *)out, _mm512_cvtpd_epi32(counts));
+        _mm256_storeu_ps(magnitude, _mm512_cvtpd_ps(_mm512_fmadd_pd(z_re, z_re, _mm512_mul_pd(z_im, z_im))));
+        for (int k = 0; k < 8 && k < left; ++k) {
+            iterations[i + k] = out[k];
+            magnitudes[i + k] = magnitude[k];
+        }
+    }
+}
+
+#endif
+
+// app.c includes this, the rest of it goes back to /fp:fast (the push doesn't save fp_contract)
+#if defined(_MSC_VER) && !defined(__clang__)
+    #pragma float_control(pop)
+    #pragma fp_contract(on)
+#endif
@@ -0,0 +1,516 @@
+#include "kernels.h"
+
+/*
+    Single precision kernels for the shallow zooms, where a float (~6e-8 relative)
+    still tells neighbouring pixels apart (see precision_for_spacing), twice the lanes
+    of the double kernels for the same register width. Same scheme as the double ones
+    otherwise, counts are kept as floats too which is exact up to 2^24 iterations.
+ */
+void escape_time_float_scalar(const escape_params_t *params, const float *re, const float *im, int count, int *iterations, float *magnitudes, escape_stats_t *stats)
+{
+    const float limit = 4.0f;
+    const float tolerance = (float)(params->cycle_tolerance * params->cycle_tolerance);
+
+    for (int i = 0; i < count; ++i)
+    {
+        if (!params->julia && in_main_cardioid_or_bulb(re[i], im[i]))
+        {
+            iterations[i] = params->max_iterations;
+            magnitudes[i] = 0.0f;
+            stats->interior_skipped++;
+            continue;
+        }
+
+        float z_re = params->julia ? re[i] : 0.0f;
+        float z_im = params->julia ? im[i] : 0.0f;
+        float c_re = params->julia ? (float)params->julia_re : re[i];
+        float c_im = params->julia ? (float)params->julia_im : im[i];
+
+        int iteration = 0;
+
+        float saved_re = z_re;
+        float saved_im = z_im;
+        int check_at = CYCLE_FIRST_CHECK;
+        bool periodic = false;
+
+        while (iteration < params->max_iterations)
+        {
+            float re_tmp = z_re*z_re - z_im*z_im + c_re;
+            z_im = 2.0f * z_re * z_im + c_im;
+            z_re = re_tmp;
+            iteration++;
+
+            if (z_re*z_re + z_im*z_im > limit)
+                break;
+
+            if (iteration == check_at)
+            {
+                saved_re = z_re;
+                saved_im = z_im;
+                check_at *= 2;
+            }
+            else
+            {
+                float d_re = z_re - saved_re;
+                float d_im = z_im - saved_im;
+                if (d_re*d_re + d_im*d_im < tolerance) {
+                    periodic = true;
+                    break;
+                }
+            }
+        }
+
+        if (periodic)
+        {
+            stats->cycle_points++;
+            stats->cycle_iterations_saved += params->max_iterations - iteration;
+            iteration = params->max_iterations;
+        }
+
+        iterations[i] = iteration;
+        magnitudes[i] = (float)(z_re*z_re + z_im*z_im);
+    }
+}
+
+#if KERNELS_X86
+
+KERNEL_TARGET("sse2")
+static inline __m128 interior_mask_float_sse2(__m128 x, __m128 y)
+{
+    __m128 y2 = _mm_mul_ps(y, y);
+    __m128 xq = _mm_sub_ps(x, _mm_set1_ps(0.25f));
+    __m128 q  = _mm_add_ps(_mm_mul_ps(xq, xq), y2);
+    __m128 cardioid = _mm_cmple_ps(_mm_mul_ps(q, _mm_add_ps(q, xq)), _mm_mul_ps(_mm_set1_ps(0.25f), y2));
+
+    __m128 xb = _mm_add_ps(x, _mm_set1_ps(1.0f));
+    __m128 bulb = _mm_cmple_ps(_mm_add_ps(_mm_mul_ps(xb, xb), y2), _mm_set1_ps(0.0625f));
+
+    return _mm_or_ps(cardioid, bulb);
+}
+
+KERNEL_TARGET("avx2,fma")
+static inline __m256 interior_mask_float_avx2(__m256 x, __m256 y)
+{
+    __m256 y2 = _mm256_mul_ps(y, y);
+    __m256 xq = _mm256_sub_ps(x, _mm256_set1_ps(0.25f));
+    __m256 q  = _mm256_fmadd_ps(xq, xq, y2);
+    __m256 cardioid = _mm256_cmp_ps(_mm256_mul_ps(q, _mm256_add_ps(q, xq)), _mm256_mul_ps(_mm256_set1_ps(0.25f), y2), _CMP_LE_OQ);
+
+    __m256 xb = _mm256_add_ps(x, _mm256_set1_ps(1.0f));
+    __m256 bulb = _mm256_cmp_ps(_mm256_fmadd_ps(xb, xb, y2), _mm256_set1_ps(0.0625f), _CMP_LE_OQ);
+
+    return _mm256_or_ps(cardioid, bulb);
+}
+
+KERNEL_TARGET("avx512f")
+static inline __mmask16 interior_mask_float_avx512(__m512 x, __m512 y)
+{
+    __m512 y2 = _mm512_mul_ps(y, y);
+    __m512 xq = _mm512_sub_ps(x, _mm512_set1_ps(0.25f));
+    __m512 q  = _mm512_fmadd_ps(xq, xq, y2);
+    __mmask16 cardioid = _mm512_cmp_ps_mask(_mm512_mul_ps(q, _mm512_add_ps(q, xq)), _mm512_mul_ps(_mm512_set1_ps(0.25f), y2), _CMP_LE_OQ);
+
+    __m512 xb = _mm512_add_ps(x, _mm512_set1_ps(1.0f));
+    __mmask16 bulb = _mm512_cmp_ps_mask(_mm512_fmadd_ps(xb, xb, y2), _mm512_set1_ps(0.0625f), _CMP_LE_OQ);
+
+    return cardioid | bulb;
+}
+
+KERNEL_TARGET("sse2")
+void escape_time_float_sse2(const escape_params_t *params, const float *re, const float *im, int count, int *iterations, float *magnitudes, escape_stats_t *stats)
+{
+    const __m128 limit = _mm_set1_ps(4.0f);
+    const __m128 one   = _mm_set1_ps(1.0f);
+    const __m128 max_iterations = _mm_set1_ps((float)params->max_iterations);
+    const __m128 tolerance = _mm_set1_ps((float)(params->cycle_tolerance * params->cycle_tolerance));
+
+    for (int i = 0; i < count; i += 8)
+    {
+        __m128 z_re[2], z_im[2], c_re[2], c_im[2];
+        __m128 re2[2], im2[2], active[2], counts[2];
+        __m128 saved_re[2], saved_im[2];
+        __m128 saved_iterations = _mm_setzero_ps();
+        int check_at = CYCLE_FIRST_CHECK;
+
+        for (int v = 0; v < 2; ++v)
+        {
+            int base = i + v * 4;
+            int left = count - base;
+
+            // no masked loads before avx, pad the tail by hand
+            float p_re[4] = {0.0f, 0.0f, 0.0f, 0.0f};
+            float p_im[4] = {0.0f, 0.0f, 0.0f, 0.0f};
+            float valid[4] = {0.0f, 0.0f, 0.0f, 0.0f};
+            for (int k = 0; k < 4 && k < left; ++k) {
+                p_re[k] = re[base + k];
+                p_im[k] = im[base + k];
+                valid[k] = 1.0f;
+            }
+            active[v] = _mm_cmpeq_ps(_mm_loadu_ps(valid), one);
+
+            if (params->julia)
+            {
+                z_re[v] = _mm_loadu_ps(p_re);
+                z_im[v] = _mm_loadu_ps(p_im);
+                c_re[v] = _mm_set1_ps((float)params->julia_re);
+                c_im[v] = _mm_set1_ps((float)params->julia_im);
+            }
+            else
+            {
+                z_re[v] = _mm_setzero_ps();
+                z_im[v] = _mm_setzero_ps();
+                c_re[v] = _mm_loadu_ps(p_re);
+                c_im[v] = _mm_loadu_ps(p_im);
+            }
+
+            re2[v] = _mm_mul_ps(z_re[v], z_re[v]);
+            im2[v] = _mm_mul_ps(z_im[v], z_im[v]);
+            counts[v] = _mm_setzero_ps();
+            saved_re[v] = z_re[v];
+            saved_im[v] = z_im[v];
+
+            if (!params->julia)
+            {
+                __m128 interior = _mm_and_ps(interior_mask_float_sse2(c_re[v], c_im[v]), active[v]);
+                active[v] = _mm_andnot_ps(interior, active[v]);
+                counts[v] = _mm_and_ps(interior, max_iterations);
+                stats->interior_skipped += mask_popcount(_mm_movemask_ps(interior));
+            }
+        }
+
+        for (int iteration = 0; iteration < params->max_iterations; ++iteration)
+        {
+            if (_mm_movemask_ps(_mm_or_ps(active[0], active[1])) == 0)
+                break;
+
+            bool save = (iteration + 1 == check_at);
+
+            for (int v = 0; v < 2; ++v)
+            {
+                __m128 n_re = _mm_add_ps(_mm_sub_ps(re2[v], im2[v]), c_re[v]);
+                __m128 n_im = _mm_add_ps(_mm_mul_ps(_mm_add_ps(z_re[v], z_re[v]), z_im[v]), c_im[v]);
+
+                z_re[v] = _mm_or_ps(_mm_and_ps(active[v], n_re), _mm_andnot_ps(active[v], z_re[v]));
+                z_im[v] = _mm_or_ps(_mm_and_ps(active[v], n_im), _mm_andnot_ps(active[v], z_im[v]));
+                counts[v] = _mm_add_ps(counts[v], _mm_and_ps(active[v], one));
+
+                re2[v] = _mm_mul_ps(z_re[v], z_re[v]);
+                im2[v] = _mm_mul_ps(z_im[v], z_im[v]);
+
+                __m128 bounded = _mm_cmple_ps(_mm_add_ps(re2[v], im2[v]), limit);
+                active[v] = _mm_and_ps(active[v], bounded);
+
+                if (save)
+                {
+                    saved_re[v] = z_re[v];
+                    saved_im[v] = z_im[v];
+                }
+                else
+                {
+                    __m128 d_re = _mm_sub_ps(z_re[v], saved_re[v]);
+                    __m128 d_im = _mm_sub_ps(z_im[v], saved_im[v]);
+                    __m128 dist = _mm_add_ps(_mm_mul_ps(d_re, d_re), _mm_mul_ps(d_im, d_im));
+                    __m128 periodic = _mm_and_ps(active[v], _mm_cmplt_ps(dist, tolerance));
+
+                    int caught = _mm_movemask_ps(periodic);
+                    if (caught)
+                    {
+                        stats->cycle_points += mask_popcount(caught);
+                        saved_iterations = _mm_add_ps(saved_iterations, _mm_and_ps(periodic, _mm_sub_ps(max_iterations, counts[v])));
+                        counts[v] = _mm_or_ps(_mm_and_ps(periodic, max_iterations), _mm_andnot_ps(periodic, counts[v]));
+                        active[v] = _mm_andnot_ps(periodic, active[v]);
+                    }
+                }
+            }
+
+            if (save) check_at *= 2;
+        }
+
+        float saved[4];
+        _mm_storeu_ps(saved, saved_iterations);
+        stats->cycle_iterations_saved += (uint64_t)saved[0] + (uint64_t)saved[1] + (uint64_t)saved[2] + (uint64_t)saved[3];
+
+        for (int v = 0; v < 2; ++v)
+        {
+            int base = i + v * 4;
+            int left = count - base;
+            if (left <= 0) break;
+
+            int out[4];
+            float magnitude[4];
+            _mm_storeu_si128((__m128i *)out, _mm_cvtps_epi32(counts[v]));
+            _mm_storeu_ps(magnitude, _mm_add_ps(re2[v], im2[v]));
+            for (int k = 0; k < 4 && k < left; ++k) {
+                iterations[base + k] = out[k];
+                magnitudes[base + k] = magnitude[k];
+            }
+        }
+    }
+}
+
+KERNEL_TARGET("avx2,fma")
+void escape_time_float_avx2(const escape_params_t *params, const float *re, const float *im, int count, int *iterations, float *magnitudes, escape_stats_t *stats)
+{
+    const __m256 limit = _mm256_set1_ps(4.0f);
+    const __m256 one   = _mm256_set1_ps(1.0f);
+    const __m256 lanes = _mm256_set_ps(7.0f, 6.0f, 5.0f, 4.0f, 3.0f, 2.0f, 1.0f, 0.0f);
+    const __m256 max_iterations = _mm256_set1_ps((float)params->max_iterations);
+    const __m256 tolerance = _mm256_set1_ps((float)(params->cycle_tolerance * params->cycle_tolerance));
+
+    for (int i = 0; i < count; i += 16)
+    {
+        __m256 z_re[2], z_im[2], c_re[2], c_im[2];
+        __m256 re2[2], im2[2], active[2], counts[2];
+        __m256 saved_re[2], saved_im[2];
+        __m256 saved_iterations = _mm256_setzero_ps();
+        int check_at = CYCLE_FIRST_CHECK;
+
+        for (int v = 0; v < 2; ++v)
+        {
+            int base = i + v * 8;
+            int left = count - base;
+
+            __m256 p_re = _mm256_setzero_ps();
+            __m256 p_im = _mm256_setzero_ps();
+            active[v] = _mm256_setzero_ps();
+
+            if (left > 0)
+            {
+                // lanes past the end of the batch are never loaded and never active
+                active[v] = _mm256_cmp_ps(lanes, _mm256_set1_ps((float)left), _CMP_LT_OQ);
+                p_re = _mm256_maskload_ps(re + base, _mm256_castps_si256(active[v]));
+                p_im = _mm256_maskload_ps(im + base, _mm256_castps_si256(active[v]));
+            }
+
+            if (params->julia)
+            {
+                z_re[v] = p_re;
+                z_im[v] = p_im;
+                c_re[v] = _mm256_set1_ps((float)params->julia_re);
+                c_im[v] = _mm256_set1_ps((float)params->julia_im);
+            }
+            else
+            {
+                z_re[v] = _mm256_setzero_ps();
+                z_im[v] = _mm256_setzero_ps();
+                c_re[v] = p_re;
+                c_im[v] = p_im;
+            }
+
+            re2[v] = _mm256_mul_ps(z_re[v], z_re[v]);
+            im2[v] = _mm256_mul_ps(z_im[v], z_im[v]);
+            counts[v] = _mm256_setzero_ps();
+            saved_re[v] = z_re[v];
+            saved_im[v] = z_im[v];
+
+            if (!params->julia)
+            {
+                __m256 interior = _mm256_and_ps(interior_mask_float_avx2(c_re[v], c_im[v]), active[v]);
+                active[v] = _mm256_andnot_ps(interior, active[v]);
+                counts[v] = _mm256_and_ps(interior, max_iterations);
+                stats->interior_skipped += mask_popcount(_mm256_movemask_ps(interior));
+            }
+        }
+
+        for (int iteration = 0; iteration < params->max_iterations; ++iteration)
+        {
+            if (_mm256_movemask_ps(_mm256_or_ps(active[0], active[1])) == 0)
+                break;
+
+            bool save = (iteration + 1 == check_at);
+
+            for (int v = 0; v < 2; ++v)
+            {
+                __m256 n_re = _mm256_add_ps(_mm256_sub_ps(re2[v], im2[v]), c_re[v]);
+                __m256 n_im = _mm256_fmadd_ps(_mm256_add_ps(z_re[v], z_re[v]), z_im[v], c_im[v]);
+
+                z_re[v] = _mm256_blendv_ps(z_re[v], n_re, active[v]);
+                z_im[v] = _mm256_blendv_ps(z_im[v], n_im, active[v]);
+                counts[v] = _mm256_add_ps(counts[v], _mm256_and_ps(active[v], one));
+
+                re2[v] = _mm256_mul_ps(z_re[v], z_re[v]);
+                im2[v] = _mm256_mul_ps(z_im[v], z_im[v]);
+
+                __m256 bounded = _mm256_cmp_ps(_mm256_add_ps(re2[v], im2[v]), limit, _CMP_LE_OQ);
+                active[v] = _mm256_and_ps(active[v], bounded);
+
+                if (save)
+                {
+                    saved_re[v] = z_re[v];
+                    saved_im[v] = z_im[v];
+                }
+                else
+                {
+                    __m256 d_re = _mm256_sub_ps(z_re[v], saved_re[v]);
+                    __m256 d_im = _mm256_sub_ps(z_im[v], saved_im[v]);
+                    __m256 dist = _mm256_fmadd_ps(d_re, d_re, _mm256_mul_ps(d_im, d_im));
+                    __m256 periodic = _mm256_and_ps(active[v], _mm256_cmp_ps(dist, tolerance, _CMP_LT_OQ));
+
+                    int caught = _mm256_movemask_ps(periodic);
+                    if (caught)
+                    {
+                        stats->cycle_points += mask_popcount(caught);
+                        saved_iterations = _mm256_add_ps(saved_iterations, _mm256_and_ps(periodic, _mm256_sub_ps(max_iterations, counts[v])));
+                        counts[v] = _mm256_blendv_ps(counts[v], max_iterations, periodic);
+                        active[v] = _mm256_andnot_ps(periodic, active[v]);
+                    }
+                }
+            }
+
+            if (save) check_at *= 2;
+        }
+
+        float saved[8];
+        _mm256_storeu_ps(saved, saved_iterations);
+        for (int k = 0; k < 8; ++k) {
+            stats->cycle_iterations_saved += (uint64_t)saved[k];
+        }
+
+        for (int v = 0; v < 2; ++v)
+        {
+            int base = i + v * 8;
+            int left = count - base;
+            if (left <= 0) break;
+
+            int out[8];
+            float magnitude[8];
+            _mm256_storeu_si256((__m256i *)out, _mm256_cvtps_epi32(counts[v]));
+            _mm256_storeu_ps(magnitude, _mm256_add_ps(re2[v], im2[v]));
+            for (int k = 0; k < 8 && k < left; ++k) {
+                iterations[base + k] = out[k];
+                magnitudes[base + k] = magnitude[k];
+            }
+        }
+    }
+}
+
+KERNEL_TARGET("avx512f")
+void escape_time_float_avx512(const escape_params_t *params, const float *re, const float *im, int count, int *iterations, float *magnitudes, escape_stats_t *stats)
+{
+    const __m512 limit = _mm512_set1_ps(4.0f);
+    const __m512 one   = _mm512_set1_ps(1.0f);
+    const __m512 max_iterations = _mm512_set1_ps((float)params->max_iterations);
+    const __m512 tolerance = _mm512_set1_ps((float)(params->cycle_tolerance * params->cycle_tolerance));
+
+    for (int i = 0; i < count; i += 32)
+    {
+        __m512 z_re[2], z_im[2], c_re[2], c_im[2];
+        __m512 re2[2], im2[2], counts[2];
+        __m512 saved_re[2], saved_im[2];
+        __m512 saved_iterations = _mm512_setzero_ps();
+        int check_at = CYCLE_FIRST_CHECK;
+        __mmask16 active[2];
+
+        for (int v = 0; v < 2; ++v)
+        {
+            int base = i + v * 16;
+            int left = count - base;
+
+            __m512 p_re = _mm512_setzero_ps();
+            __m512 p_im = _mm512_setzero_ps();
+            active[v] = 0;
+
+            if (left > 0)
+            {
+                active[v] = (left >= 16) ? 0xFFFF : (__mmask16)((1u << left) - 1);
+                p_re = _mm512_maskz_loadu_ps(active[v], re + base);
+                p_im = _mm512_maskz_loadu_ps(active[v], im + base);
+            }
+
+            if (params->julia)
+            {
+                z_re[v] = p_re;
+                z_im[v] = p_im;
+                c_re[v] = _mm512_set1_ps((float)params->julia_re);
+                c_im[v] = _mm512_set1_ps((float)params->julia_im);
+            }
+            else
+            {
+                z_re[v] = _mm512_setzero_ps();
+                z_im[v] = _mm512_setzero_ps();
+                c_re[v] = p_re;
+                c_im[v] = p_im;
+            }
+
+            re2[v] = _mm512_mul_ps(z_re[v], z_re[v]);
+            im2[v] = _mm512_mul_ps(z_im[v], z_im[v]);
+            counts[v] = _mm512_setzero_ps();
+            saved_re[v] = z_re[v];
+            saved_im[v] = z_im[v];
+
+            if (!params->julia)
+            {
+                __mmask16 interior = interior_mask_float_avx512(c_re[v], c_im[v]) & active[v];
+                active[v] &= (__mmask16)~interior;
+                counts[v] = _mm512_maskz_mov_ps(interior, max_iterations);
+                stats->interior_skipped += mask_popcount(interior);
+            }
+        }
+
+        for (int iteration = 0; iteration < params->max_iterations; ++iteration)
+        {
+            if ((active[0] | active[1]) == 0)
+                break;
+
+            bool save = (iteration + 1 == check_at);
+
+            for (int v = 0; v < 2; ++v)
+            {
+                __m512 n_re = _mm512_add_ps(_mm512_sub_ps(re2[v], im2[v]), c_re[v]);
+                __m512 n_im = _mm512_fmadd_ps(_mm512_add_ps(z_re[v], z_re[v]), z_im[v], c_im[v]);
+
+                z_re[v] = _mm512_mask_mov_ps(z_re[v], active[v], n_re);
+                z_im[v] = _mm512_mask_mov_ps(z_im[v], active[v], n_im);
+                counts[v] = _mm512_mask_add_ps(counts[v], active[v], counts[v], one);
+
+                re2[v] = _mm512_mul_ps(z_re[v], z_re[v]);
+                im2[v] = _mm512_mul_ps(z_im[v], z_im[v]);
+
+                active[v] = _mm512_mask_cmp_ps_mask(active[v], _mm512_add_ps(re2[v], im2[v]), limit, _CMP_LE_OQ);
+
+                if (save)
+                {
+                    saved_re[v] = z_re[v];
+                    saved_im[v] = z_im[v];
+                }
+                else
+                {
+                    __m512 d_re = _mm512_sub_ps(z_re[v], saved_re[v]);
+                    __m512 d_im = _mm512_sub_ps(z_im[v], saved_im[v]);
+                    __m512 dist = _mm512_fmadd_ps(d_re, d_re, _mm512_mul_ps(d_im, d_im));
+                    __mmask16 periodic = _mm512_mask_cmp_ps_mask(active[v], dist, tolerance, _CMP_LT_OQ);
+
+                    if (periodic)
+                    {
+                        stats->cycle_points += mask_popcount(periodic);
+                        saved_iterations = _mm512_mask_add_ps(saved_iterations, periodic, saved_iterations, _mm512_sub_ps(max_iterations, counts[v]));
+                        counts[v] = _mm512_mask_mov_ps(counts[v], periodic, max_iterations);
+                        active[v] &= (__mmask16)~periodic;
+                    }
+                }
+            }
+
+            if (save) check_at *= 2;
+        }
+
+        stats->cycle_iterations_saved += (uint64_t)_mm512_reduce_add_ps(saved_iterations);
+
+        for (int v = 0; v < 2; ++v)
+        {
+            int base = i + v * 16;
+            int left = count - base;
+            if (left <= 0) break;
+
+            int out[16];
+            float magnitude[16];
+            _mm512_storeu_si512((void *)out, _mm512_cvtps_epi32(counts[v]));
+            _mm512_storeu_ps(magnitude, _mm512_add_ps(re2[v], im2[v]));
+            for (int k = 0; k < 16 && k < left; ++k) {
+                iterations[base + k] = out[k];
+                magnitudes[base + k] = magnitude[k];
+            }
+        }
+    }
+}
+
+#endif
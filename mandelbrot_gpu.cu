@@ -3,6 +3,20 @@
 #include <stdio.h>
 #include <math.h>
 
+/*
+    Same closed form test as the cpu kernels (kernels.h), main cardioid and period-2 bulb
+ */
+__device__ bool in_main_cardioid_or_bulb(double x, double y)
+{
+    double y2 = y * y;
+    double xq = x - 0.25;
+    double q = xq * xq + y2;
+    if (q * (q + xq) <= 0.25 * y2) return true;
+
+    double xb = x + 1.0;
+    return xb * xb + y2 <= 0.0625;
+}
+
 __global__ void mandelbrot_kernel(
     uint32_t* output,
     uint32_t width,
@@ -10,12 +24,14 @@ __global__ void mandelbrot_kernel(
     double center_x,
     double center_y,
     double scale,
-    int max_iterations)
+    int max_iterations,
+    unsigned long long* interior_skipped)
 {
     uint32_t x = blockIdx.x * blockDim.x + threadIdx.x;
     uint32_t y = blockIdx.y * blockDim.y + threadIdx.y;
     
-    if (x >= width || y >= height) return;
+    // no early return, every thread of the block has to reach the __syncthreads_count below
+    bool on_screen = (x < width && y < height);
     
     double c_re = center_x + (x - width / 2.0) * scale;
     double c_im = center_y + (y - height / 2.0) * scale;
@@ -26,6 +42,20 @@ __global__ void mandelbrot_kernel(
     int iteration = 0;
 
     const double limit = 4.0;
+
+    bool interior = on_screen && in_main_cardioid_or_bulb(c_re, c_im);
+
+    // one atomic per block instead of one per interior pixel
+    int block_interior = __syncthreads_count(interior);
+    if (threadIdx.x == 0 && threadIdx.y == 0 && block_interior > 0) {
+        atomicAdd(interior_skipped, (unsigned long long)block_interior);
+    }
+
+    if (!on_screen) return;
+
+    if (interior) {
+        iteration = max_iterations;
+    }
     
     while (iteration < max_iterations) 
     {
@@ -64,12 +94,14 @@ __global__ void mandelbrot_kernel(
 extern "C" {
 
 uint32_t* d_output;
+unsigned long long* d_interior_skipped;
 static size_t g_allocated_size = 0;
 
 void cuda_init(uint32_t max_width, uint32_t max_height)
 {
     size_t max_size = max_width * max_height * sizeof(uint32_t);
     cudaMalloc(&d_output, max_size);
+    cudaMalloc(&d_interior_skipped, sizeof(unsigned long long));
     g_allocated_size = max_size;
 }
 
@@ -80,6 +112,10 @@ void cuda_cleanup(void)
         d_output = NULL;
         g_allocated_size = 0;
     }
+    if (d_interior_skipped) {
+        cudaFree(d_interior_skipped);
+        d_interior_skipped = NULL;
+    }
 }
 
 void cuda_render_mandelbrot(
@@ -89,7 +125,8 @@ void cuda_render_mandelbrot(
     double center_x,
     double center_y,
     double scale,
-    int max_iterations)
+    int max_iterations,
+    uint64_t* interior_skipped)
 {
     size_t pixel_count = width * height;
     size_t buffer_size = pixel_count * sizeof(uint32_t);
@@ -107,10 +144,13 @@ void cuda_render_mandelbrot(
         (height + block_size.y - 1) / block_size.y
     );
     
+    cudaMemset(d_interior_skipped, 0, sizeof(unsigned long long));
+    
     mandelbrot_kernel<<<grid_size, block_size>>>(
         d_output, width, height,
         center_x, center_y, scale,
-        max_iterations
+        max_iterations,
+        d_interior_skipped
     );
     
     cudaError_t err = cudaGetLastError();
@@ -123,6 +163,12 @@ void cuda_render_mandelbrot(
     cudaDeviceSynchronize();
     
     cudaMemcpy(output, d_output, buffer_size, cudaMemcpyDeviceToHost);
+
+    if (interior_skipped) {
+        unsigned long long skipped = 0;
+        cudaMemcpy(&skipped, d_interior_skipped, sizeof(skipped), cudaMemcpyDeviceToHost);
+        *interior_skipped = skipped;
+    }
 }
 
 int cuda_is_available()
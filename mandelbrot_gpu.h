@@ -14,7 +14,8 @@ void cuda_render_mandelbrot(
     double center_x,
     double center_y,
     double scale,
-    int max_iterations);
+    int max_iterations,
+    uint64_t* interior_skipped);
 
 void cuda_init(uint32_t max_width, uint32_t max_height);
 void cuda_cleanup(void);
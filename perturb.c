@@ -0,0 +1,511 @@
+#include "perturb.h"
+
+#include <stdlib.h>
+#include <math.h>
+
+void ref_orbit_compute(ref_orbit_t *orbit, const hp_t *c_re, const hp_t *c_im, int limbs, int max_iterations)
+{
+    if (orbit->capacity < max_iterations + 1)
+    {
+        free(orbit->z_re);
+        free(orbit->z_im);
+        orbit->capacity = max_iterations + 1;
+        orbit->z_re = malloc(orbit->capacity * sizeof(double));
+        orbit->z_im = malloc(orbit->capacity * sizeof(double));
+    }
+
+    orbit->c_re = *c_re;
+    orbit->c_im = *c_im;
+    orbit->limbs = limbs;
+    orbit->max_iterations = max_iterations;
+
+    hp_t z_re, z_im;
+    hp_zero(&z_re);
+    hp_zero(&z_im);
+
+    orbit->z_re[0] = 0.0;
+    orbit->z_im[0] = 0.0;
+    orbit->length = 0;
+
+    for (int n = 0; n < max_iterations; ++n)
+    {
+        hp_mandelbrot_step(&z_re, &z_im, c_re, c_im, limbs);
+
+        double re = hp_to_double(&z_re, limbs);
+        double im = hp_to_double(&z_im, limbs);
+
+        orbit->z_re[n + 1] = re;
+        orbit->z_im[n + 1] = im;
+        orbit->length = n + 1;
+
+        if (re*re + im*im > 4.0)
+            break;
+    }
+}
+
+void direct_escape_time(const hp_t *center_re, const hp_t *center_im, int limbs, int max_iterations,
+                        const fe_t *dc_re, const fe_t *dc_im, int count, int *iterations, float *magnitudes)
+{
+    for (int i = 0; i < count; ++i)
+    {
+        hp_t c_re, c_im, z_re, z_im;
+        hp_add_fe(&c_re, center_re, dc_re[i], limbs);
+        hp_add_fe(&c_im, center_im, dc_im[i], limbs);
+        hp_zero(&z_re);
+        hp_zero(&z_im);
+
+        // the step reports the magnitude of z_n before moving on to z_n+1
+        int n = 0;
+        double magnitude = 0.0;
+        while (n < max_iterations && (magnitude = hp_mandelbrot_step(&z_re, &z_im, &c_re, &c_im, limbs)) <= 4.0) {
+            n++;
+        }
+
+        iterations[i] = n;
+        magnitudes[i] = (float)magnitude;
+    }
+}
+
+void ref_orbit_free(ref_orbit_t *orbit)
+{
+    free(orbit->z_re);
+    free(orbit->z_im);
+    orbit->z_re = NULL;
+    orbit->z_im = NULL;
+    orbit->capacity = 0;
+    orbit->length = 0;
+}
+
+void bla_build(bla_table_t *table, const ref_orbit_t *orbit, double dc_max)
+{
+    // Z_0 = 0 has no linear part (dz -> dz^2 + dc), the table starts at Z_1
+    int singles = orbit->length - 1;
+
+    int total = 0;
+    for (int count = singles; count > 0; count /= 2) {
+        total += count;
+    }
+
+    if (table->capacity < total)
+    {
+        free(table->storage);
+        table->capacity = total;
+        table->storage = malloc(total * sizeof(bla_step_t));
+    }
+
+    table->orbit = orbit;
+    table->orbit_length = orbit->length;
+    table->dc_max = dc_max;
+    table->levels = 0;
+
+    bla_step_t *next = table->storage;
+
+    for (int j = 0; j < singles; ++j)
+    {
+        double z_re = orbit->z_re[1 + j];
+        double z_im = orbit->z_im[1 + j];
+
+        // |dz^2| stays below epsilon times the linear term |2 Z dz|
+        next[j] = (bla_step_t){
+            .a_re = 2.0 * z_re, .a_im = 2.0 * z_im,
+            .b_re = 1.0, .b_im = 0.0,
+            .radius = BLA_EPSILON * sqrt(z_re*z_re + z_im*z_im)
+        };
+    }
+
+    if (singles > 0)
+    {
+        table->steps[0] = next;
+        table->counts[0] = singles;
+        table->levels = 1;
+        next += singles;
+    }
+
+    while (table->levels < BLA_MAX_LEVELS && table->counts[table->levels - 1] >= 2)
+    {
+        const bla_step_t *lower = table->steps[table->levels - 1];
+        int count = table->counts[table->levels - 1] / 2;
+
+        for (int j = 0; j < count; ++j)
+        {
+            const bla_step_t *x = &lower[2 * j];
+            const bla_step_t *y = &lower[2 * j + 1];
+
+            double ax = sqrt(x->a_re*x->a_re + x->a_im*x->a_im);
+            double bx = sqrt(x->b_re*x->b_re + x->b_im*x->b_im);
+
+            double radius = x->radius;
+            if (ax > 0.0) {
+                radius = fmin(radius, (y->radius - bx * dc_max) / ax);
+            }
+
+            next[j] = (bla_step_t){
+                .a_re = y->a_re*x->a_re - y->a_im*x->a_im,
+                .a_im = y->a_re*x->a_im + y->a_im*x->a_re,
+                .b_re = y->a_re*x->b_re - y->a_im*x->b_im + y->b_re,
+                .b_im = y->a_re*x->b_im + y->a_im*x->b_re + y->b_im,
+                .radius = fmax(0.0, radius)
+            };
+        }
+
+        table->steps[table->levels] = next;
+        table->counts[table->levels] = count;
+        table->levels++;
+        next += count;
+    }
+}
+
+void bla_free(bla_table_t *table)
+{
+    free(table->storage);
+    table->storage = NULL;
+    table->capacity = 0;
+    table->levels = 0;
+    table->orbit = NULL;
+}
+
+/*
+    Longest step starting at reference index "ref" that is valid for |dz|^2 and does not
+    run past the iteration cap. A merged step is never valid further out than its first
+    half, so going up the levels we can stop at the first one that fails.
+    Single steps are not worth taking, they cost as much as the exact perturbation step.
+ */
+static const bla_step_t *bla_lookup(const bla_table_t *table, int ref, double dz_mag, int iterations_left, int *step_length)
+{
+    int index = ref - 1;
+
+    // the blocks at level k start every 2^k entries
+    if (index < 0 || (index & 1)) 
+        return NULL;
+
+    const bla_step_t *best = NULL;
+
+    for (int level = 1; level < table->levels; ++level)
+    {
+        int length = 1 << level;
+        int j = index >> level;
+
+        if ((index & (length - 1)) || j >= table->counts[level] || length > iterations_left) 
+            break;
+
+        const bla_step_t *step = &table->steps[level][j];
+        if (dz_mag >= step->radius * step->radius)
+            break;
+
+        best = step;
+        *step_length = length;
+    }
+
+    return best;
+}
+
+/*
+    The double loop, carries on from wherever dz / ref / iteration are, returns the
+    final iteration count and |z|^2 there.
+ */
+static int perturb_iterate(const ref_orbit_t *orbit, const bla_table_t *bla, double dc_re, double dc_im,
+                           double dz_re, double dz_im, int ref, int iteration, float *magnitude, escape_stats_t *stats)
+{
+    const double limit = 4.0;
+    const int max_iterations = orbit->max_iterations;
+
+    double dz_mag = dz_re*dz_re + dz_im*dz_im;
+    double z_mag = 0.0;
+
+    while (iteration < max_iterations)
+    {
+        int step_length = 0;
+        const bla_step_t *step = bla ? bla_lookup(bla, ref, dz_mag, max_iterations - iteration, &step_length) : NULL;
+
+        if (step)
+        {
+            // dz = A dz + B dc
+            double re_tmp = step->a_re*dz_re - step->a_im*dz_im + step->b_re*dc_re - step->b_im*dc_im;
+            dz_im = step->a_re*dz_im + step->a_im*dz_re + step->b_re*dc_im + step->b_im*dc_re;
+            dz_re = re_tmp;
+
+            ref += step_length;
+            iteration += step_length;
+            stats->bla_iterations_skipped += step_length;
+        }
+        else
+        {
+            // dz = (2Z + dz) dz + dc
+            double t_re = 2.0 * orbit->z_re[ref] + dz_re;
+            double t_im = 2.0 * orbit->z_im[ref] + dz_im;
+
+            double re_tmp = t_re*dz_re - t_im*dz_im + dc_re;
+            dz_im = t_re*dz_im + t_im*dz_re + dc_im;
+            dz_re = re_tmp;
+
+            ref++;
+            iteration++;
+        }
+
+        double z_re = orbit->z_re[ref] + dz_re;
+        double z_im = orbit->z_im[ref] + dz_im;
+        z_mag = z_re*z_re + z_im*z_im;
+
+        if (z_mag > limit)
+            break;
+
+        dz_mag = dz_re*dz_re + dz_im*dz_im;
+
+        /*
+            Once the pixel's orbit is closer to 0 than to the reference, dz carries
+            more of z than Z does and the deltas lose their meaning (a glitch),
+            z itself is a perfectly good delta from Z_0 = 0 though.
+         */
+        if (z_mag < dz_mag || ref == orbit->length)
+        {
+            dz_re = z_re;
+            dz_im = z_im;
+            dz_mag = z_mag;
+            ref = 0;
+            stats->rebases++;
+        }
+    }
+
+    *magnitude = (float)z_mag;
+    return iteration;
+}
+
+void perturb_escape_time(const ref_orbit_t *orbit, const bla_table_t *bla, const double *dc_re, const double *dc_im, int count,
+                         int *iterations, float *magnitudes, escape_stats_t *stats)
+{
+    for (int i = 0; i < count; ++i) {
+        iterations[i] = perturb_iterate(orbit, bla, dc_re[i], dc_im[i], 0.0, 0.0, 0, 0, &magnitudes[i], stats);
+    }
+}
+
+/*
+    dz is back in double range, and far enough above dc that dropping dc's bits below
+    the double range does not matter.
+ */
+static bool fe_can_hand_off(int64_t dz_exp, int64_t dc_exp)
+{
+    return dz_exp > FE_HANDOFF_EXP && (dc_exp > FE_HANDOFF_EXP || dz_exp > dc_exp + 64);
+}
+
+/*
+    The same loop as perturb_iterate without BLA, dz stays small compared to Z for as
+    long as it needs the exponent, so the glitch check only matters near Z = 0.
+    Returns false if the pixel escaped or ran out of iterations before the handoff.
+ */
+static bool perturb_iterate_fe(const ref_orbit_t *orbit, fe_t dc_re, fe_t dc_im,
+                               fe_t *dz_re, fe_t *dz_im, int *ref, int *iteration, float *magnitude, escape_stats_t *stats)
+{
+    const int max_iterations = orbit->max_iterations;
+    int64_t dc_exp = dc_re.e > dc_im.e ? dc_re.e : dc_im.e;
+    *magnitude = 0.0f;
+
+    while (*iteration < max_iterations)
+    {
+        if (fe_can_hand_off(dz_re->e > dz_im->e ? dz_re->e : dz_im->e, dc_exp))
+            return true;
+
+        fe_t t_re = fe_add(fe_from_double(2.0 * orbit->z_re[*ref]), *dz_re);
+        fe_t t_im = fe_add(fe_from_double(2.0 * orbit->z_im[*ref]), *dz_im);
+
+        fe_t re_tmp = fe_add(fe_sub(fe_mul(t_re, *dz_re), fe_mul(t_im, *dz_im)), dc_re);
+        *dz_im = fe_add(fe_add(fe_mul(t_re, *dz_im), fe_mul(t_im, *dz_re)), dc_im);
+        *dz_re = re_tmp;
+
+        (*ref)++;
+        (*iteration)++;
+
+        fe_t z_re = fe_add(fe_from_double(orbit->z_re[*ref]), *dz_re);
+        fe_t z_im = fe_add(fe_from_double(orbit->z_im[*ref]), *dz_im);
+        fe_t z_mag = fe_add(fe_mul(z_re, z_re), fe_mul(z_im, z_im));
+
+        double mag = fe_to_double(z_mag);
+        *magnitude = (float)mag;
+        if (mag > 4.0)
+            return false;
+
+        fe_t dz_mag = fe_add(fe_mul(*dz_re, *dz_re), fe_mul(*dz_im, *dz_im));
+
+        if (fe_less_abs(z_mag, dz_mag) || *ref == orbit->length)
+        {
+            *dz_re = z_re;
+            *dz_im = z_im;
+            *ref = 0;
+            stats->rebases++;
+        }
+    }
+
+    return false;
+}
+
+#if KERNELS_X86
+
+KERNEL_TARGET("avx2")
+static inline fe4_t fe4_select(__m256i mask, fe4_t a, fe4_t b)
+{
+    fe4_t r;
+    r.m = _mm256_blendv_pd(b.m, a.m, _mm256_castsi256_pd(mask));
+    r.e = _mm256_blendv_epi8(b.e, a.e, mask);
+    return r;
+}
+
+KERNEL_TARGET("avx2")
+static inline __m256i max_epi64_avx2(__m256i a, __m256i b)
+{
+    return _mm256_blendv_epi8(a, b, _mm256_cmpgt_epi64(b, a));
+}
+
+/*
+    perturb_iterate_fe on four pixels at once, each lane drops out when it escapes,
+    runs out of iterations or can be handed off, its state is written back for the
+    double loop to pick up.
+ */
+KERNEL_TARGET("avx2")
+static void perturb_iterate_fe_avx2(const ref_orbit_t *orbit, const fe_t *dc_re, const fe_t *dc_im,
+                                    fe_t *dz_re_out, fe_t *dz_im_out, int *ref_out, int *iteration_out,
+                                    bool *handoff_out, float *magnitude_out, escape_stats_t *stats)
+{
+    const __m256i one = _mm256_set1_epi64x(1);
+    const __m256i max_iterations = _mm256_set1_epi64x(orbit->max_iterations);
+    const __m256i length = _mm256_set1_epi64x(orbit->length);
+    const __m256i handoff_exp = _mm256_set1_epi64x(FE_HANDOFF_EXP);
+    const __m256i margin = _mm256_set1_epi64x(64);
+    const __m256i four_exp = _mm256_set1_epi64x(3);     // 4 = 0.5 * 2^3
+    const __m256d two = _mm256_set1_pd(2.0);
+    const __m256d half = _mm256_set1_pd(0.5);
+
+    fe4_t dc_r = { _mm256_setr_pd(dc_re[0].m, dc_re[1].m, dc_re[2].m, dc_re[3].m),
+                   _mm256_setr_epi64x(dc_re[0].e, dc_re[1].e, dc_re[2].e, dc_re[3].e) };
+    fe4_t dc_i = { _mm256_setr_pd(dc_im[0].m, dc_im[1].m, dc_im[2].m, dc_im[3].m),
+                   _mm256_setr_epi64x(dc_im[0].e, dc_im[1].e, dc_im[2].e, dc_im[3].e) };
+    __m256i dc_exp = max_epi64_avx2(dc_r.e, dc_i.e);
+    __m256i dc_in_range = _mm256_cmpgt_epi64(dc_exp, handoff_exp);
+
+    fe4_t dz_r = fe4_from_double(_mm256_setzero_pd());
+    fe4_t dz_i = dz_r;
+    fe4_t escape_mag = dz_r;
+    __m256i ref = _mm256_setzero_si256();
+    __m256i iteration = _mm256_setzero_si256();
+    __m256i rebases = _mm256_setzero_si256();
+
+    __m256i active = _mm256_set1_epi64x(-1);
+    __m256i handoff = _mm256_setzero_si256();
+
+    for (;;)
+    {
+        __m256i dz_exp = max_epi64_avx2(dz_r.e, dz_i.e);
+        __m256i ready = _mm256_and_si256(_mm256_cmpgt_epi64(dz_exp, handoff_exp),
+                                         _mm256_or_si256(dc_in_range, _mm256_cmpgt_epi64(dz_exp, _mm256_add_epi64(dc_exp, margin))));
+        handoff = _mm256_or_si256(handoff, _mm256_and_si256(active, ready));
+        active = _mm256_andnot_si256(ready, active);
+        active = _mm256_and_si256(active, _mm256_cmpgt_epi64(max_iterations, iteration));
+
+        if (_mm256_testz_si256(active, active))
+            break;
+
+        __m256d z_re = _mm256_i64gather_pd(orbit->z_re, ref, 8);
+        __m256d z_im = _mm256_i64gather_pd(orbit->z_im, ref, 8);
+
+        fe4_t t_r = fe4_add(fe4_from_double(_mm256_mul_pd(two, z_re)), dz_r);
+        fe4_t t_i = fe4_add(fe4_from_double(_mm256_mul_pd(two, z_im)), dz_i);
+
+        fe4_t next_r = fe4_add(fe4_sub(fe4_mul(t_r, dz_r), fe4_mul(t_i, dz_i)), dc_r);
+        fe4_t next_i = fe4_add(fe4_add(fe4_mul(t_r, dz_i), fe4_mul(t_i, dz_r)), dc_i);
+
+        dz_r = fe4_select(active, next_r, dz_r);
+        dz_i = fe4_select(active, next_i, dz_i);
+        ref = _mm256_add_epi64(ref, _mm256_and_si256(active, one));
+        iteration = _mm256_add_epi64(iteration, _mm256_and_si256(active, one));
+
+        z_re = _mm256_i64gather_pd(orbit->z_re, ref, 8);
+        z_im = _mm256_i64gather_pd(orbit->z_im, ref, 8);
+
+        fe4_t zr = fe4_add(fe4_from_double(z_re), dz_r);
+        fe4_t zi = fe4_add(fe4_from_double(z_im), dz_i);
+        fe4_t z_mag = fe4_add(fe4_mul(zr, zr), fe4_mul(zi, zi));
+
+        // |z|^2 > 4, the mantissa is in [0.5, 1)
+        __m256i escaped = _mm256_or_si256(_mm256_cmpgt_epi64(z_mag.e, four_exp),
+                                          _mm256_and_si256(_mm256_cmpeq_epi64(z_mag.e, four_exp),
+                                                           _mm256_castpd_si256(_mm256_cmp_pd(z_mag.m, half, _CMP_GT_OQ))));
+        escape_mag = fe4_select(_mm256_and_si256(escaped, active), z_mag, escape_mag);
+        active = _mm256_andnot_si256(escaped, active);
+
+        fe4_t dz_mag = fe4_add(fe4_mul(dz_r, dz_r), fe4_mul(dz_i, dz_i));
+
+        __m256i rebase = _mm256_or_si256(fe4_less_abs(z_mag, dz_mag), _mm256_cmpeq_epi64(ref, length));
+        rebase = _mm256_and_si256(rebase, active);
+
+        dz_r = fe4_select(rebase, zr, dz_r);
+        dz_i = fe4_select(rebase, zi, dz_i);
+        ref = _mm256_andnot_si256(rebase, ref);
+        rebases = _mm256_sub_epi64(rebases, rebase);
+    }
+
+    double m_r[4], m_i[4], m_mag[4];
+    int64_t e_r[4], e_i[4], e_mag[4], refs[4], iterations[4], rebase_counts[4], handoffs[4];
+    _mm256_storeu_pd(m_r, dz_r.m);
+    _mm256_storeu_pd(m_i, dz_i.m);
+    _mm256_storeu_pd(m_mag, escape_mag.m);
+    _mm256_storeu_si256((__m256i *)e_r, dz_r.e);
+    _mm256_storeu_si256((__m256i *)e_i, dz_i.e);
+    _mm256_storeu_si256((__m256i *)e_mag, escape_mag.e);
+    _mm256_storeu_si256((__m256i *)refs, ref);
+    _mm256_storeu_si256((__m256i *)iterations, iteration);
+    _mm256_storeu_si256((__m256i *)rebase_counts, rebases);
+    _mm256_storeu_si256((__m256i *)handoffs, handoff);
+
+    for (int k = 0; k < 4; ++k)
+    {
+        dz_re_out[k] = (fe_t){ m_r[k], e_r[k] };
+        dz_im_out[k] = (fe_t){ m_i[k], e_i[k] };
+        ref_out[k] = (int)refs[k];
+        iteration_out[k] = (int)iterations[k];
+        handoff_out[k] = handoffs[k] != 0;
+        magnitude_out[k] = (float)fe_to_double((fe_t){ m_mag[k], e_mag[k] });
+        stats->rebases += rebase_counts[k];
+    }
+}
+
+#endif
+
+void perturb_escape_time_fe(const ref_orbit_t *orbit, const bla_table_t *bla, const fe_t *dc_re, const fe_t *dc_im, int count,
+                            int *iterations, float *magnitudes, escape_stats_t *stats)
+{
+    int i = 0;
+
+#if KERNELS_X86
+    if (g_kernels.isa >= KERNEL_AVX2)
+    {
+        for (; i + 4 <= count; i += 4)
+        {
+            fe_t dz_re[4], dz_im[4];
+            int ref[4], iteration[4];
+            bool handoff[4];
+
+            perturb_iterate_fe_avx2(orbit, dc_re + i, dc_im + i, dz_re, dz_im, ref, iteration, handoff, magnitudes + i, stats);
+
+            for (int k = 0; k < 4; ++k)
+            {
+                iterations[i + k] = handoff[k] ? perturb_iterate(orbit, bla, fe_to_double(dc_re[i + k]), fe_to_double(dc_im[i + k]),
+                                                                 fe_to_double(dz_re[k]), fe_to_double(dz_im[k]), ref[k], iteration[k],
+                                                                 &magnitudes[i + k], stats)
+                                               : iteration[k];
+            }
+        }
+    }
+#endif
+
+    for (; i < count; ++i)
+    {
+        fe_t dz_re = fe_from_double(0.0);
+        fe_t dz_im = fe_from_double(0.0);
+        int ref = 0;
+        int iteration = 0;
+
+        bool handoff = perturb_iterate_fe(orbit, dc_re[i], dc_im[i], &dz_re, &dz_im, &ref, &iteration, &magnitudes[i], stats);
+
+        iterations[i] = handoff ? perturb_iterate(orbit, bla, fe_to_double(dc_re[i]), fe_to_double(dc_im[i]),
+                                                  fe_to_double(dz_re), fe_to_double(dz_im), ref, iteration, &magnitudes[i], stats)
+                                : iteration;
+    }
+}
@@ -0,0 +1,117 @@
+#ifndef PERTURB_H_
+#define PERTURB_H_
+
+#include "hp.h"
+#include "kernels.h"
+
+/*
+    Perturbation rendering for zooms a double cannot resolve anymore.
+
+    A single reference point C is iterated at high precision and its orbit Z_n is
+    stored as doubles (|Z| < 2 so that is plenty), every pixel c = C + dc then only
+    iterates its difference from that orbit:
+
+        z_n = Z_n + dz_n
+        dz_{n+1} = 2 Z_n dz_n + dz_n^2 + dc = (2 Z_n + dz_n) dz_n + dc
+
+    dz and dc are tiny but a double does not care about magnitude, only about
+    relative precision, so the per pixel cost is the same as the plain kernel.
+
+    Glitches (pixels whose orbit stops following the reference) are avoided by
+    rebasing: when |z| drops below |dz| or the reference runs out (it escaped early)
+    the pixel restarts from the beginning of the reference with dz = z.
+
+    Takes over from the double-double kernels at DEEP_ZOOM_SCALE, those have ~1e-32
+    of precision but the long orbits this deep amplify the rounding, past 1e-20 they
+    disagree with direct iteration on more pixels than perturbation does.
+ */
+#define DEEP_ZOOM_SCALE 1e-20
+
+typedef struct
+{
+    hp_t c_re;
+    hp_t c_im;
+    int limbs;
+    int max_iterations;
+
+    // Z_0 .. Z_length are valid, length < max_iterations means the reference escaped
+    int length;
+    int capacity;
+    double *z_re;
+    double *z_im;
+} ref_orbit_t;
+
+void ref_orbit_compute(ref_orbit_t *orbit, const hp_t *c_re, const hp_t *c_im, int limbs, int max_iterations);
+void ref_orbit_free(ref_orbit_t *orbit);
+
+/*
+    Ground truth, every point iterated at full precision with no approximation at
+    all, c = center + dc. Hundreds of times slower than perturbation, it is there
+    to check the faster paths against.
+ */
+void direct_escape_time(const hp_t *center_re, const hp_t *center_im, int limbs, int max_iterations,
+                        const fe_t *dc_re, const fe_t *dc_im, int count, int *iterations, float *magnitudes);
+
+/*
+    Bivariate linear approximation (BLA), while dz is small enough the dz^2 term of
+    the perturbation step is noise and l steps collapse into one linear map:
+
+        dz_{m+l} = A dz_m + B dc        valid while |dz_m| < radius
+
+    Single steps (A = 2 Z_m, B = 1) are merged pairwise into steps of 2, 4, 8 ...
+    iterations, a pixel takes the longest step that starts at its reference index
+    and whose radius still covers its dz.
+
+    Merging x then y : A = Ay Ax,  B = Ay Bx + By,
+                       radius = min(rx, (ry - |Bx| max|dc|) / |Ax|)
+    so a table is only good for pixels within dc_max of the reference.
+
+    Epsilon is the relative error a single step may add, 2^-24 is what's usually
+    quoted but after a rebase the orbits are chaotic and that much error changed
+    about 1 in 10 pixels at 1e-30, 2^-40 keeps them in line with plain perturbation.
+ */
+#define BLA_EPSILON     (1.0 / (double)(1ull << 40))
+#define BLA_MAX_LEVELS  32
+
+typedef struct
+{
+    double a_re, a_im;
+    double b_re, b_im;
+    double radius;
+} bla_step_t;
+
+typedef struct
+{
+    const ref_orbit_t *orbit;
+    int orbit_length;
+    double dc_max;
+
+    // level k, entry j jumps 2^k iterations starting at reference index 1 + j * 2^k
+    int levels;
+    int counts[BLA_MAX_LEVELS];
+    bla_step_t *steps[BLA_MAX_LEVELS];
+
+    bla_step_t *storage;
+    int capacity;
+} bla_table_t;
+
+void bla_build(bla_table_t *table, const ref_orbit_t *orbit, double dc_max);
+void bla_free(bla_table_t *table);
+
+/* dc is the offset of every point from the reference point, bla may be NULL to iterate every step */
+void perturb_escape_time(const ref_orbit_t *orbit, const bla_table_t *bla, const double *dc_re, const double *dc_im, int count,
+                         int *iterations, float *magnitudes, escape_stats_t *stats);
+
+/*
+    Past EXTENDED_SCALE the pixel spacing (and with it dc and the early dz) no longer
+    fits a double, dz is iterated as floatexp until it has grown back into range,
+    a pixel then carries on in the double loop above (BLA included) with dc rounded
+    to a double. dc is far below the last bit of dz by then so nothing is lost.
+ */
+#define EXTENDED_SCALE      1e-290
+#define FE_HANDOFF_EXP      (-960)
+
+void perturb_escape_time_fe(const ref_orbit_t *orbit, const bla_table_t *bla, const fe_t *dc_re, const fe_t *dc_im, int count,
+                            int *iterations, float *magnitudes, escape_stats_t *stats);
+
+#endif
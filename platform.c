@@ -19,6 +19,9 @@
 
 #include "app_api.h"
 
+#include "util.h"
+#include "util.c"
+
 typedef struct 
 {
     GLFWwindow *window;
@@ -27,7 +30,6 @@ typedef struct
     
     uint32_t screen_width;
     uint32_t screen_height;
-    color_t *pixels;
     
     int32_t mouse_x, mouse_y;
     int32_t mouse_last_x, mouse_last_y;
@@ -77,6 +79,59 @@ typedef struct
 
 platform_state_t plat = {0};
 
+/*
+    app_render runs on its own thread, the main loop only handles input and presents,
+    so the window keeps responding however long a frame takes.
+
+    Finished frames go through a triple buffer: the render thread draws into "back",
+    the main loop shows "front" and the third one sits in "ready" with the newest
+    finished frame. Each side only ever swaps its own buffer with the one in "ready"
+    (an atomic exchange) and FRAME_NEW says whether that holds a frame the main loop
+    has not taken yet, so neither ever waits on the other and a frame replaced before
+    it was shown is just dropped.
+
+    The other way, the main loop hands over a copy of the app state after every
+    app_update, a newer one overwrites whatever was not picked up yet so rendering
+    always starts on the latest view. A frame that app_update made stale is abandoned
+    halfway (see g_view_generation in app.c) and never published.
+
+    app_render can also show a frame before it is done (platform_api_t.present), what it
+    passes (the back buffer, or a copy no worker is writing to) goes into a fourth "spare"
+    one owned by the render thread and that goes through "ready" instead, so drawing
+    carries on where it was.
+ */
+#define FRAME_NEW 4
+
+typedef struct
+{
+    color_t *pixels;
+    uint32_t width;
+    uint32_t height;
+} frame_buffer_t;
+
+typedef struct
+{
+    thread_handle_t thread;
+    bool running;
+
+    mutex_t lock;
+    cond_t wake;
+    bool stop;
+
+    // the latest request, guarded by lock
+    bool pending;
+    platform_api_t api;
+    app_state_t state;
+
+    frame_buffer_t buffers[4];
+    int back;                   // render thread's
+    int spare;                  // render thread's too, for presenting unfinished frames
+    int front;                  // main loop's
+    atomic_i64_t ready;         // buffer index | FRAME_NEW
+} render_thread_t;
+
+render_thread_t renderer = { .back = 0, .front = 1, .ready = 2, .spare = 3 };
+
 
 /*
     To automatically check whether a new version of the dll is produced
@@ -153,7 +208,7 @@ int compile_app_dll(void)
         if (pid == 0) 
         {
             chdir("..");
-            execlp("gcc", "gcc", "-shared", "-fPIC", "-o", "build/app.so", 
+            execlp("gcc", "gcc", "-shared", "-fPIC", "-O2", "-o", "build/app.so", 
                    "app.c", "-Iinclude", "-Iexternal/include", "-DBUILD_DLL", NULL);
             exit(1);
         } 
@@ -214,8 +269,13 @@ void check_compile_finished(void)
     #endif
 }
 
+void render_thread_stop(void);
+
 void unload_app_dll(void) 
 {
+    // it is running dll code
+    render_thread_stop();
+
     if (plat.app_dll) 
     {
         if (plat.app_cleanup) 
@@ -306,6 +366,8 @@ int load_app_dll(void)
     return 1;
 }
 
+void render_thread_start(void);
+
 void check_for_reload(void) 
 {
     const char *dll_path = 
@@ -340,6 +402,8 @@ void check_for_reload(void)
                 platform_api_t api = {0};
                 plat.app_on_reload(&api, &plat.app_state);
             }
+
+            render_thread_start();
         } 
         else 
         {
@@ -358,22 +422,24 @@ void check_for_reload(void)
     header[16] = (b);\
     header[17] |= 0x20 
     
-void save_screenshot(void) 
+void save_screenshot(const frame_buffer_t *frame) 
 {
+    if (!frame->pixels) return;
+
     FILE *f = fopen("screenshot.tga", "wb");
     if (!f) return;
     
     uint8_t header[18] = {0};
-    TGA_HEADER(header, plat.screen_width, plat.screen_height, 32);
+    TGA_HEADER(header, frame->width, frame->height, 32);
 
     fwrite(header, sizeof(uint8_t), 18, f);
     
-    for (uint32_t i = 0; i < plat.screen_width * plat.screen_height; i++) 
+    for (uint32_t i = 0; i < frame->width * frame->height; i++) 
     {
-        fputc(plat.pixels[i].b, f);
-        fputc(plat.pixels[i].g, f);
-        fputc(plat.pixels[i].r, f);
-        fputc(plat.pixels[i].a, f);
+        fputc(frame->pixels[i].b, f);
+        fputc(frame->pixels[i].g, f);
+        fputc(frame->pixels[i].r, f);
+        fputc(frame->pixels[i].a, f);
     }
     
     fclose(f);
@@ -393,30 +459,147 @@ void init_framebuffer(void)
                            GL_TEXTURE_2D, plat.texture, 0);
 }
 
-void blit_to_screen(void) 
+void blit_to_screen(const frame_buffer_t *frame) 
 {
+    // nothing finished yet
+    if (!frame->pixels) return;
+
     glBindTexture(GL_TEXTURE_2D, plat.texture);
     glTexSubImage2D(GL_TEXTURE_2D, 0, 0, 0, 
-                    plat.screen_width, plat.screen_height,
-                    GL_RGBA, GL_UNSIGNED_BYTE, plat.pixels);
+                    frame->width, frame->height,
+                    GL_RGBA, GL_UNSIGNED_BYTE, frame->pixels);
     
     glBindFramebuffer(GL_READ_FRAMEBUFFER, plat.read_fbo);
     glBindFramebuffer(GL_DRAW_FRAMEBUFFER, 0);
     
-    glBlitFramebuffer(0, 0, plat.screen_width, plat.screen_height,
+    // a frame from before a resize gets stretched until the new size catches up
+    glBlitFramebuffer(0, 0, frame->width, frame->height,
                       0, plat.screen_height, plat.screen_width, 0,
                       GL_COLOR_BUFFER_BIT, GL_NEAREST);
 }
 
+void fit_frame_buffer(frame_buffer_t *frame, uint32_t width, uint32_t height)
+{
+    if (frame->width != width || frame->height != height)
+    {
+        free(frame->pixels);
+        frame->pixels = calloc(width * height, sizeof(color_t));
+        frame->width = width;
+        frame->height = height;
+    }
+}
+
+/* platform_api_t.present, called on the render thread from inside app_render */
+void present_partial_frame(platform_api_t *api, const color_t *pixels)
+{
+    frame_buffer_t *spare = &renderer.buffers[renderer.spare];
+    fit_frame_buffer(spare, api->screen_width, api->screen_height);
+
+    memcpy(spare->pixels, pixels, api->screen_width * api->screen_height * sizeof(color_t));
+    renderer.spare = (int)(atomic_exchange_i64(&renderer.ready, renderer.spare | FRAME_NEW) & 3);
+}
+
+thread_func_ret_t render_thread_main(thread_func_param_t param)
+{
+    (void) param;
+
+    for (;;)
+    {
+        mutex_lock(&renderer.lock);
+        while (!renderer.pending && !renderer.stop) {
+            cond_wait(&renderer.wake, &renderer.lock);
+        }
+
+        if (renderer.stop)
+        {
+            mutex_unlock(&renderer.lock);
+            break;
+        }
+
+        platform_api_t api = renderer.api;
+        app_state_t state = renderer.state;
+        renderer.pending = false;
+        mutex_unlock(&renderer.lock);
+
+        frame_buffer_t *frame = &renderer.buffers[renderer.back];
+        fit_frame_buffer(frame, api.screen_width, api.screen_height);
+
+        api.pixels = frame->pixels;
+        api.frame_incomplete = false;
+
+        plat.app_render(&api, &state);
+
+        if (!api.frame_incomplete) {
+            renderer.back = (int)(atomic_exchange_i64(&renderer.ready, renderer.back | FRAME_NEW) & 3);
+        }
+    }
+
+    #ifdef _WIN32
+        return 0;
+    #else
+        return NULL;
+    #endif
+}
+
+void render_thread_start(void)
+{
+    if (renderer.running || !plat.app_render)
+        return;
+
+    mutex_init(&renderer.lock);
+    cond_init(&renderer.wake);
+    renderer.stop = false;
+    renderer.running = true;
+    renderer.thread = create_thread(render_thread_main, NULL);
+}
+
+void render_thread_stop(void)
+{
+    if (!renderer.running)
+        return;
+
+    // whatever it is drawing gets finished first
+    mutex_lock(&renderer.lock);
+    renderer.stop = true;
+    cond_signal(&renderer.wake);
+    mutex_unlock(&renderer.lock);
+
+    join_thread(renderer.thread);
+
+    cond_destroy(&renderer.wake);
+    mutex_destroy(&renderer.lock);
+    renderer.running = false;
+}
+
+/* A newer request replaces one the render thread has not started on */
+void render_thread_request(const platform_api_t *api, const app_state_t *state)
+{
+    if (!renderer.running)
+        return;
+
+    mutex_lock(&renderer.lock);
+    renderer.api = *api;
+    renderer.state = *state;
+    renderer.pending = true;
+    cond_signal(&renderer.wake);
+    mutex_unlock(&renderer.lock);
+}
+
+/* Takes the newest finished frame if there is one, otherwise keeps showing the last */
+const frame_buffer_t *latest_frame(void)
+{
+    if (atomic_load_i64(&renderer.ready) & FRAME_NEW) {
+        renderer.front = (int)(atomic_exchange_i64(&renderer.ready, renderer.front) & 3);
+    }
+    return &renderer.buffers[renderer.front];
+}
+
 void framebuffer_size_callback(GLFWwindow* window, int width, int height) 
 {
     (void)window;
     plat.screen_width = width;
     plat.screen_height = height;
     glViewport(0, 0, width, height);
-    
-    free(plat.pixels);
-    plat.pixels = malloc(plat.screen_width * plat.screen_height * sizeof(color_t));
 }
 
 void key_callback(GLFWwindow* window, int key, int scancode, int action, int mods)
@@ -507,8 +690,9 @@ void fill_platform_api(platform_api_t *api)
 {
     api->screen_width = plat.screen_width;
     api->screen_height = plat.screen_height;
-    api->pixels = plat.pixels;
-    
+    api->pixels = NULL;         // the render thread points it at its back buffer
+    api->present = present_partial_frame;
+
     api->mouse_x = plat.mouse_x;
     api->mouse_y = plat.mouse_y;
     api->mouse_delta_x = plat.mouse_x - plat.mouse_last_x;
@@ -534,6 +718,7 @@ void fill_platform_api(platform_api_t *api)
     
     api->should_quit = false;
     api->capture_frame = false;
+    api->frame_incomplete = false;
 }
 
 void apply_platform_api(platform_api_t *api) 
@@ -543,7 +728,7 @@ void apply_platform_api(platform_api_t *api)
     }
     
     if (api->capture_frame) {
-        save_screenshot();
+        save_screenshot(&renderer.buffers[renderer.front]);
     }
 }
 
@@ -621,8 +806,6 @@ int main(void)
     
     init_framebuffer();
     
-    plat.pixels = malloc(plat.screen_width * plat.screen_height * sizeof(color_t));
-    
     if (!load_app_dll()) {
         fprintf(stderr, "Failed to load app DLL\n");
         return 1;
@@ -633,6 +816,8 @@ int main(void)
         fill_platform_api(&api);
         plat.app_init(&api, &plat.app_state);
     }
+
+    render_thread_start();
     
     plat.running = true;
     plat.last_time = glfwGetTime();
@@ -659,18 +844,19 @@ int main(void)
             plat.app_update(&api, &plat.app_state);
         }
         
-        if (plat.app_render) {
-            plat.app_render(&api, &plat.app_state);
-        }
+        // picked up by the render thread, whatever finished last gets shown meanwhile
+        render_thread_request(&api, &plat.app_state);
         
         apply_platform_api(&api);
         
-        blit_to_screen();
+        blit_to_screen(latest_frame());
         glfwSwapBuffers(plat.window);
     }
     
     unload_app_dll();
-    free(plat.pixels);
+    for (int i = 0; i < 4; ++i) {
+        free(renderer.buffers[i].pixels);
+    }
     glfwTerminate();
     
     return 0;
@@ -65,6 +65,14 @@ void prof_reset(void);
 void prof_print_results(void);
 void prof_sort_results(void);
 
+/*
+    For time measured where a PROFILE block cannot go (worker threads), adds to the
+    entry with the same label, call it from one thread only.
+    Recorded entries are taken from the top of the table down to stay clear of the
+    __COUNTER__ slots.
+*/
+void prof_record(const char* label, double elapsed_ms, uint64_t hit_count);
+
 #define PROFILE(name) \
     prof_zone CONCAT_AUX(_prof_, __LINE__); \
     DEFER(prof_block_start(&CONCAT_AUX(_prof_, __LINE__), name, __COUNTER__), prof_block_end(&CONCAT_AUX(_prof_, __LINE__)))
@@ -147,6 +155,39 @@ void prof_block_end(prof_zone* zone)
     }
 }
 
+void prof_record(const char* label, double elapsed_ms, uint64_t hit_count)
+{
+    int free_slot = -1;
+
+    for (int i = MAX_PROFILE_ENTRIES - 1; i >= 0; i--) 
+    {
+        prof_entry* entry = &g_prof_storage.entries[i];
+
+        if (entry->hit_count > 0 && entry->label && strcmp(entry->label, label) == 0) 
+        {
+            entry->elapsed_ms += elapsed_ms;
+            entry->hit_count += hit_count;
+            return;
+        }
+
+        if (entry->hit_count == 0 && free_slot < 0) {
+            free_slot = i;
+        }
+    }
+
+    if (free_slot < 0 || hit_count == 0) {
+        return;
+    }
+
+    g_prof_storage.entries[free_slot].label = label;
+    g_prof_storage.entries[free_slot].elapsed_ms = elapsed_ms;
+    g_prof_storage.entries[free_slot].hit_count = hit_count;
+
+    if (free_slot >= g_prof_storage.count) {
+        g_prof_storage.count = free_slot + 1;
+    }
+}
+
 void prof_init(void) 
 {
     memset(&g_prof_storage, 0, sizeof(g_prof_storage));
@@ -0,0 +1,447 @@
+#include "thread_pool.h"
+
+#include <stdlib.h>
+#include <string.h>
+
+#include "prof.h"
+
+/*
+    Chase-Lev work stealing deque, fixed size.
+    bottom is only written by the owner, top only moves up through a CAS, the one
+    race that matters is the owner and a thief going for the last job, the CAS on
+    top settles it for both.
+ */
+typedef struct
+{
+    atomic_i64_t top;
+    char pad0[64 - sizeof(atomic_i64_t)];   // thieves hammer top, keep it off the owner's line
+    atomic_i64_t bottom;
+    char pad1[64 - sizeof(atomic_i64_t)];
+    job_t jobs[POOL_DEQUE_SIZE];
+} pool_deque_t;
+
+typedef struct
+{
+    pool_deque_t deque;
+
+    uint32_t rng;                   // picks where stealing starts
+
+    atomic_i64_t busy_ns;           // running totals, the batch stats are differences
+    atomic_i64_t jobs;
+    atomic_i64_t steals;
+} pool_worker_t;
+
+typedef struct
+{
+    mutex_t lock;
+    cond_t work_available;
+    cond_t work_done;
+
+    // shared queue for jobs from outside the pool, ring buffer, grows when full
+    job_t *jobs;
+    int capacity;
+    int head;
+    int count;
+
+    atomic_i64_t available;         // jobs sitting in the queue or any deque
+    atomic_i64_t pending;           // jobs submitted and not finished yet
+    atomic_i64_t idle;              // workers not running a job
+    atomic_i64_t sleeping;          // workers waiting on work_available
+    bool stop;
+    bool running;
+
+    // batch stats, see pool_worker_stats_t
+    bool batch_open;
+    uint64_t batch_start;
+    int64_t batch_busy_ns[POOL_MAX_THREADS];
+    int64_t batch_jobs[POOL_MAX_THREADS];
+    int64_t batch_steals[POOL_MAX_THREADS];
+    pool_worker_stats_t last_batch[POOL_MAX_THREADS];
+
+    int thread_count;
+    thread_handle_t threads[POOL_MAX_THREADS];
+    pool_worker_t *workers;
+} thread_pool_t;
+
+static thread_pool_t g_pool = {0};
+
+// the worker the current thread is, NULL outside the pool
+static THREAD_LOCAL pool_worker_t *t_worker = NULL;
+
+static bool deque_push(pool_deque_t *d, job_t job)
+{
+    int64_t b = atomic_load_i64(&d->bottom);
+    int64_t t = atomic_load_i64(&d->top);
+
+    if (b - t >= POOL_DEQUE_SIZE)
+        return false;
+
+    d->jobs[b & (POOL_DEQUE_SIZE - 1)] = job;
+    atomic_store_i64(&d->bottom, b + 1);
+    return true;
+}
+
+static bool deque_pop(pool_deque_t *d, job_t *job)
+{
+    int64_t b = atomic_load_i64(&d->bottom) - 1;
+    atomic_store_i64(&d->bottom, b);
+    atomic_fence();
+    int64_t t = atomic_load_i64(&d->top);
+
+    if (t > b)
+    {
+        // was empty
+        atomic_store_i64(&d->bottom, b + 1);
+        return false;
+    }
+
+    *job = d->jobs[b & (POOL_DEQUE_SIZE - 1)];
+    if (t < b)
+        return true;
+
+    // the last one, a thief may be after it too
+    bool won = atomic_cas_i64(&d->top, t, t + 1);
+    atomic_store_i64(&d->bottom, b + 1);
+    return won;
+}
+
+static bool deque_steal(pool_deque_t *d, job_t *job)
+{
+    int64_t t = atomic_load_i64(&d->top);
+    atomic_fence();
+    int64_t b = atomic_load_i64(&d->bottom);
+
+    if (t >= b)
+        return false;
+
+    *job = d->jobs[t & (POOL_DEQUE_SIZE - 1)];
+    return atomic_cas_i64(&d->top, t, t + 1);
+}
+
+static void pool_wake_one(void)
+{
+    if (atomic_load_i64(&g_pool.sleeping) > 0)
+    {
+        mutex_lock(&g_pool.lock);
+        cond_signal(&g_pool.work_available);
+        mutex_unlock(&g_pool.lock);
+    }
+}
+
+static bool pool_take_queued(job_t *job)
+{
+    bool found = false;
+
+    mutex_lock(&g_pool.lock);
+    if (g_pool.count > 0)
+    {
+        *job = g_pool.jobs[g_pool.head];
+        g_pool.head = (g_pool.head + 1) % g_pool.capacity;
+        g_pool.count--;
+        found = true;
+    }
+    mutex_unlock(&g_pool.lock);
+
+    return found;
+}
+
+static bool pool_find_job(pool_worker_t *self, job_t *job)
+{
+    if (deque_pop(&self->deque, job))
+        return true;
+
+    if (pool_take_queued(job))
+        return true;
+
+    // xorshift, so the thieves don't all line up on the same victim
+    self->rng ^= self->rng << 13;
+    self->rng ^= self->rng >> 17;
+    self->rng ^= self->rng << 5;
+
+    int n = g_pool.thread_count;
+    int first = (int)(self->rng % (uint32_t)n);
+
+    for (int i = 0; i < n; ++i)
+    {
+        pool_worker_t *victim = &g_pool.workers[(first + i) % n];
+        if (victim != self && deque_steal(&victim->deque, job))
+        {
+            atomic_add_i64(&self->steals, 1);
+            return true;
+        }
+    }
+
+    return false;
+}
+
+static thread_func_ret_t pool_worker(thread_func_param_t param)
+{
+    pool_worker_t *self = (pool_worker_t *)param;
+    t_worker = self;
+
+    for (;;)
+    {
+        job_t job;
+
+        if (pool_find_job(self, &job))
+        {
+            atomic_add_i64(&g_pool.available, -1);
+            atomic_add_i64(&g_pool.idle, -1);
+
+            uint64_t start = prof_get_time();
+            job.func(job.data);
+            atomic_add_i64(&self->busy_ns, (int64_t)(prof_get_time() - start));
+            atomic_add_i64(&self->jobs, 1);
+
+            atomic_add_i64(&g_pool.idle, 1);
+
+            if (atomic_add_i64(&g_pool.pending, -1) == 0)
+            {
+                mutex_lock(&g_pool.lock);
+                cond_broadcast(&g_pool.work_done);
+                mutex_unlock(&g_pool.lock);
+            }
+            continue;
+        }
+
+        // a lost steal leaves available up, go around again instead of sleeping
+        if (atomic_load_i64(&g_pool.available) > 0)
+            continue;
+
+        mutex_lock(&g_pool.lock);
+
+        // stopping still drains everything
+        bool stop = g_pool.stop;
+        if (!stop)
+        {
+            atomic_add_i64(&g_pool.sleeping, 1);
+            while (atomic_load_i64(&g_pool.available) == 0 && !g_pool.stop) {
+                cond_wait(&g_pool.work_available, &g_pool.lock);
+            }
+            atomic_add_i64(&g_pool.sleeping, -1);
+        }
+
+        mutex_unlock(&g_pool.lock);
+
+        if (stop)
+            break;
+    }
+
+    t_worker = NULL;
+
+    #ifdef _WIN32
+        return 0;
+    #else
+        return NULL;
+    #endif
+}
+
+void pool_start(int num_threads)
+{
+    if (g_pool.running)
+        return;
+
+    if (num_threads <= 0) num_threads = get_core_count();
+    if (num_threads > POOL_MAX_THREADS) num_threads = POOL_MAX_THREADS;
+
+    mutex_init(&g_pool.lock);
+    cond_init(&g_pool.work_available);
+    cond_init(&g_pool.work_done);
+
+    g_pool.capacity = 1024;
+    g_pool.jobs = malloc(g_pool.capacity * sizeof(job_t));
+    g_pool.head = 0;
+    g_pool.count = 0;
+    g_pool.available = 0;
+    g_pool.pending = 0;
+    g_pool.idle = num_threads;
+    g_pool.sleeping = 0;
+    g_pool.stop = false;
+    g_pool.batch_open = false;
+    memset(g_pool.last_batch, 0, sizeof(g_pool.last_batch));
+    g_pool.running = true;
+
+    g_pool.workers = calloc(num_threads, sizeof(pool_worker_t));
+    g_pool.thread_count = num_threads;
+    for (int i = 0; i < num_threads; ++i)
+    {
+        g_pool.workers[i].rng = 0x9e3779b9u * (uint32_t)(i + 1);
+        g_pool.threads[i] = create_thread(pool_worker, &g_pool.workers[i]);
+    }
+}
+
+void pool_stop(void)
+{
+    if (!g_pool.running)
+        return;
+
+    mutex_lock(&g_pool.lock);
+    g_pool.stop = true;
+    cond_broadcast(&g_pool.work_available);
+    mutex_unlock(&g_pool.lock);
+
+    for (int i = 0; i < g_pool.thread_count; ++i) {
+        join_thread(g_pool.threads[i]);
+    }
+
+    cond_destroy(&g_pool.work_available);
+    cond_destroy(&g_pool.work_done);
+    mutex_destroy(&g_pool.lock);
+
+    free(g_pool.jobs);
+    free(g_pool.workers);
+    g_pool.jobs = NULL;
+    g_pool.workers = NULL;
+    g_pool.thread_count = 0;
+    g_pool.running = false;
+}
+
+bool pool_running(void)
+{
+    return g_pool.running;
+}
+
+int pool_thread_count(void)
+{
+    return g_pool.thread_count;
+}
+
+int pool_worker_index(void)
+{
+    return t_worker ? (int)(t_worker - g_pool.workers) : -1;
+}
+
+void pool_submit(job_func_t func, void *data)
+{
+    if (!g_pool.running)
+    {
+        func(data);
+        return;
+    }
+
+    job_t job = { func, data };
+    atomic_add_i64(&g_pool.pending, 1);
+
+    if (t_worker && deque_push(&t_worker->deque, job))
+    {
+        atomic_add_i64(&g_pool.available, 1);
+        pool_wake_one();
+        return;
+    }
+
+    mutex_lock(&g_pool.lock);
+
+    if (!g_pool.batch_open)
+    {
+        // first job since the last wait, the stats count from here
+        g_pool.batch_open = true;
+        g_pool.batch_start = prof_get_time();
+        for (int i = 0; i < g_pool.thread_count; ++i)
+        {
+            g_pool.batch_busy_ns[i] = atomic_load_i64(&g_pool.workers[i].busy_ns);
+            g_pool.batch_jobs[i] = atomic_load_i64(&g_pool.workers[i].jobs);
+            g_pool.batch_steals[i] = atomic_load_i64(&g_pool.workers[i].steals);
+        }
+    }
+
+    if (g_pool.count == g_pool.capacity)
+    {
+        // unroll the ring into the bigger buffer
+        job_t *jobs = malloc(2 * g_pool.capacity * sizeof(job_t));
+        for (int i = 0; i < g_pool.count; ++i) {
+            jobs[i] = g_pool.jobs[(g_pool.head + i) % g_pool.capacity];
+        }
+        free(g_pool.jobs);
+        g_pool.jobs = jobs;
+        g_pool.capacity *= 2;
+        g_pool.head = 0;
+    }
+
+    g_pool.jobs[(g_pool.head + g_pool.count) % g_pool.capacity] = job;
+    g_pool.count++;
+    atomic_add_i64(&g_pool.available, 1);
+
+    cond_signal(&g_pool.work_available);
+    mutex_unlock(&g_pool.lock);
+}
+
+// the lock is held, everything has finished
+static void pool_close_batch(void)
+{
+    if (!g_pool.batch_open)
+        return;
+
+    g_pool.batch_open = false;
+    double elapsed_ms = (double)(prof_get_time() - g_pool.batch_start) / 1000000.0;
+
+    for (int i = 0; i < g_pool.thread_count; ++i)
+    {
+        pool_worker_t *worker = &g_pool.workers[i];
+        pool_worker_stats_t *stats = &g_pool.last_batch[i];
+
+        stats->busy_ms = (double)(atomic_load_i64(&worker->busy_ns) - g_pool.batch_busy_ns[i]) / 1000000.0;
+        stats->idle_ms = elapsed_ms > stats->busy_ms ? elapsed_ms - stats->busy_ms : 0.0;
+        stats->jobs = (uint64_t)(atomic_load_i64(&worker->jobs) - g_pool.batch_jobs[i]);
+        stats->steals = (uint64_t)(atomic_load_i64(&worker->steals) - g_pool.batch_steals[i]);
+    }
+}
+
+void pool_wait(void)
+{
+    if (!g_pool.running)
+        return;
+
+    mutex_lock(&g_pool.lock);
+    while (atomic_load_i64(&g_pool.pending) > 0) {
+        cond_wait(&g_pool.work_done, &g_pool.lock);
+    }
+    pool_close_batch();
+    mutex_unlock(&g_pool.lock);
+}
+
+bool pool_wait_for(double timeout_ms)
+{
+    if (!g_pool.running)
+        return true;
+
+    uint64_t deadline = prof_get_time() + (uint64_t)(timeout_ms * 1000000.0);
+
+    mutex_lock(&g_pool.lock);
+    while (atomic_load_i64(&g_pool.pending) > 0)
+    {
+        // can wake up for nothing, only what is left of the timeout counts
+        uint64_t now = prof_get_time();
+        if (now >= deadline || !cond_wait_ms(&g_pool.work_done, &g_pool.lock, (double)(deadline - now) / 1000000.0))
+            break;
+    }
+
+    bool done = atomic_load_i64(&g_pool.pending) == 0;
+    if (done) {
+        pool_close_batch();
+    }
+    mutex_unlock(&g_pool.lock);
+
+    return done;
+}
+
+bool pool_wants_work(void)
+{
+    if (!g_pool.running || !t_worker)
+        return false;
+
+    return atomic_load_i64(&g_pool.idle) > 0 && atomic_load_i64(&g_pool.available) == 0;
+}
+
+int pool_worker_stats(pool_worker_stats_t *stats, int max)
+{
+    if (!g_pool.running)
+        return 0;
+
+    int count = g_pool.thread_count < max ? g_pool.thread_count : max;
+
+    mutex_lock(&g_pool.lock);
+    memcpy(stats, g_pool.last_batch, count * sizeof(pool_worker_stats_t));
+    mutex_unlock(&g_pool.lock);
+
+    return count;
+}
@@ -0,0 +1,80 @@
+#ifndef THREAD_POOL_H_
+#define THREAD_POOL_H_
+
+#include <stdbool.h>
+
+#include "util.h"
+
+/*
+    Worker threads started once and kept around for every frame.
+
+    Jobs from outside go into a shared queue, jobs submitted by a running job go on
+    that worker's own deque (Chase-Lev: the owner pushes and pops at the bottom
+    without a lock, everyone else steals from the top with a compare-and-swap).
+    A worker runs its own deque first, then the shared queue, then steals, and sleeps
+    on a condition variable once there is nothing left anywhere.
+    So a job that finds the others idle can split itself up and the pieces get picked
+    up right away, see pool_wants_work().
+
+    Started in app_init / app_on_reload and stopped in app_cleanup, the workers run
+    code from the dll so they can not outlive it across a reload.
+ */
+typedef void (*job_func_t)(void *data);
+
+typedef struct
+{
+    job_func_t func;
+    void *data;
+} job_t;
+
+#define POOL_MAX_THREADS 256
+
+// per worker, a power of two, a full deque spills into the shared queue
+#define POOL_DEQUE_SIZE 1024
+
+/*
+    What a worker did between the first pool_submit after a pool_wait and the
+    pool_wait that finished it, idle is the rest of that time.
+ */
+typedef struct
+{
+    double busy_ms;
+    double idle_ms;
+    uint64_t jobs;
+    uint64_t steals;
+} pool_worker_stats_t;
+
+/* num_threads <= 0 starts one per core */
+void pool_start(int num_threads);
+
+/* Finishes whatever is queued, then joins the workers */
+void pool_stop(void);
+
+bool pool_running(void);
+int pool_thread_count(void);
+
+/* The worker the calling thread is, 0 .. pool_thread_count() - 1, -1 outside the pool */
+int pool_worker_index(void);
+
+/*
+    Without a running pool the job just runs on the calling thread.
+    From inside a job it goes on the worker's own deque.
+ */
+void pool_submit(job_func_t func, void *data);
+
+/* Blocks until every job, and every job those submitted, has finished */
+void pool_wait(void);
+
+/* pool_wait that gives up after timeout_ms, true when everything had finished */
+bool pool_wait_for(double timeout_ms);
+
+/*
+    For a running job: some worker is idle and nothing is queued for it, worth
+    splitting the job and submitting the rest.
+ */
+bool pool_wants_work(void);
+
+/* Stats of the last finished batch, returns the worker count */
+int pool_worker_stats(pool_worker_stats_t *stats, int max);
+
+#endif
@@ -1,5 +1,17 @@
 #include "util.h"
 
+#if defined(__x86_64__) || defined(_M_X64) || defined(__i386__) || defined(_M_IX86)
+    #define UTIL_X86 1
+    #ifdef _MSC_VER
+        #include <intrin.h>
+        #include <immintrin.h>
+    #else
+        #include <cpuid.h>
+    #endif
+#else
+    #define UTIL_X86 0
+#endif
+
 #ifdef _WIN32
     typedef HANDLE thread_handle_t;
     typedef DWORD (WINAPI *thread_func_t)(LPVOID);
@@ -7,6 +19,7 @@
     typedef DWORD WINAPI thread_func_ret_t;
 #else
     #include <pthread.h>
+    #include <time.h>
     typedef pthread_t thread_handle_t;
     typedef void* (*thread_func_t)(void*);
     typedef void* thread_func_param_t;
@@ -40,6 +53,104 @@ void join_thread(thread_handle_t thread)
     #endif
 }
 
+void mutex_init(mutex_t *mutex)
+{
+    #ifdef _WIN32
+        InitializeCriticalSection(mutex);
+    #else
+        pthread_mutex_init(mutex, NULL);
+    #endif
+}
+
+void mutex_destroy(mutex_t *mutex)
+{
+    #ifdef _WIN32
+        DeleteCriticalSection(mutex);
+    #else
+        pthread_mutex_destroy(mutex);
+    #endif
+}
+
+void mutex_lock(mutex_t *mutex)
+{
+    #ifdef _WIN32
+        EnterCriticalSection(mutex);
+    #else
+        pthread_mutex_lock(mutex);
+    #endif
+}
+
+void mutex_unlock(mutex_t *mutex)
+{
+    #ifdef _WIN32
+        LeaveCriticalSection(mutex);
+    #else
+        pthread_mutex_unlock(mutex);
+    #endif
+}
+
+void cond_init(cond_t *cond)
+{
+    #ifdef _WIN32
+        InitializeConditionVariable(cond);
+    #else
+        pthread_cond_init(cond, NULL);
+    #endif
+}
+
+void cond_destroy(cond_t *cond)
+{
+    #ifdef _WIN32
+        (void) cond;    // nothing to free
+    #else
+        pthread_cond_destroy(cond);
+    #endif
+}
+
+void cond_wait(cond_t *cond, mutex_t *mutex)
+{
+    #ifdef _WIN32
+        SleepConditionVariableCS(cond, mutex, INFINITE);
+    #else
+        pthread_cond_wait(cond, mutex);
+    #endif
+}
+
+bool cond_wait_ms(cond_t *cond, mutex_t *mutex, double timeout_ms)
+{
+    #ifdef _WIN32
+        return SleepConditionVariableCS(cond, mutex, (DWORD)timeout_ms) != 0;
+    #else
+        // pthread wants an absolute time on the realtime clock
+        struct timespec deadline;
+        clock_gettime(CLOCK_REALTIME, &deadline);
+
+        int64_t ns = deadline.tv_nsec + (int64_t)(timeout_ms * 1000000.0);
+        deadline.tv_sec += ns / 1000000000;
+        deadline.tv_nsec = ns % 1000000000;
+
+        return pthread_cond_timedwait(cond, mutex, &deadline) == 0;
+    #endif
+}
+
+void cond_signal(cond_t *cond)
+{
+    #ifdef _WIN32
+        WakeConditionVariable(cond);
+    #else
+        pthread_cond_signal(cond);
+    #endif
+}
+
+void cond_broadcast(cond_t *cond)
+{
+    #ifdef _WIN32
+        WakeAllConditionVariable(cond);
+    #else
+        pthread_cond_broadcast(cond);
+    #endif
+}
+
 int get_core_count(void) 
 {
     #ifdef _WIN32
@@ -49,4 +160,66 @@ int get_core_count(void)
     #else
         return sysconf(_SC_NPROCESSORS_ONLN);
     #endif
+}
+
+#if UTIL_X86
+static void cpuid(int leaf, int subleaf, unsigned int regs[4])
+{
+    #ifdef _MSC_VER
+        __cpuidex((int *)regs, leaf, subleaf);
+    #else
+        __cpuid_count(leaf, subleaf, regs[0], regs[1], regs[2], regs[3]);
+    #endif
+}
+
+/* Which register states the OS actually saves on a context switch */
+static uint64_t read_xcr0(void)
+{
+    #ifdef _MSC_VER
+        return _xgetbv(0);
+    #else
+        uint32_t lo, hi;
+        __asm__ volatile("xgetbv" : "=a"(lo), "=d"(hi) : "c"(0));
+        return ((uint64_t)hi << 32) | lo;
+    #endif
+}
+#endif
+
+/*
+    The cpu reporting an instruction set is not enough, the OS also has to
+    save the wider registers (XCR0) or the first AVX instruction faults.
+ */
+cpu_features_t get_cpu_features(void)
+{
+    cpu_features_t features = {0};
+
+    #if UTIL_X86
+        unsigned int regs[4];
+
+        cpuid(0, 0, regs);
+        unsigned int max_leaf = regs[0];
+
+        cpuid(1, 0, regs);
+        features.sse2 = (regs[3] >> 26) & 1;
+
+        bool osxsave = (regs[2] >> 27) & 1;
+        bool avx     = (regs[2] >> 28) & 1;
+        bool fma     = (regs[2] >> 12) & 1;
+
+        uint64_t xcr0 = osxsave ? read_xcr0() : 0;
+        bool os_ymm = (xcr0 & 0x06) == 0x06;      // xmm + ymm
+        bool os_zmm = (xcr0 & 0xE6) == 0xE6;      // + opmask, zmm_hi256, hi16_zmm
+
+        features.avx = avx && os_ymm;
+        features.fma = fma && os_ymm;
+
+        if (max_leaf >= 7) 
+        {
+            cpuid(7, 0, regs);
+            features.avx2    = features.avx && ((regs[1] >> 5) & 1);
+            features.avx512f = os_zmm && ((regs[1] >> 16) & 1);
+        }
+    #endif
+
+    return features;
 }
\ No newline at end of file
@@ -8,16 +8,81 @@
     typedef DWORD (WINAPI *thread_func_t)(LPVOID);
     typedef LPVOID thread_func_param_t;
     typedef DWORD WINAPI thread_func_ret_t;
+    typedef CRITICAL_SECTION mutex_t;
+    typedef CONDITION_VARIABLE cond_t;
 #else
     #include <pthread.h>
     typedef pthread_t thread_handle_t;
     typedef void* (*thread_func_t)(void*);
     typedef void* thread_func_param_t;
     typedef void* thread_func_ret_t;
+    typedef pthread_mutex_t mutex_t;
+    typedef pthread_cond_t cond_t;
 #endif
 
+#include <stdint.h>
+#include <stdbool.h>
+
+typedef struct
+{
+    bool sse2;
+    bool avx;
+    bool avx2;
+    bool fma;
+    bool avx512f;
+} cpu_features_t;
+
 thread_handle_t create_thread(thread_func_t func, thread_func_param_t data);
 void join_thread(thread_handle_t thread);
+
+void mutex_init(mutex_t *mutex);
+void mutex_destroy(mutex_t *mutex);
+void mutex_lock(mutex_t *mutex);
+void mutex_unlock(mutex_t *mutex);
+
+void cond_init(cond_t *cond);
+void cond_destroy(cond_t *cond);
+void cond_wait(cond_t *cond, mutex_t *mutex);     // mutex is held on entry and on return
+bool cond_wait_ms(cond_t *cond, mutex_t *mutex, double timeout_ms);  // false once the timeout ran out
+void cond_signal(cond_t *cond);
+void cond_broadcast(cond_t *cond);
+
+/*
+    The few atomics the thread pool needs, all sequentially consistent.
+    Kept to 64 bit integers behind functions since msvc's C11 <stdatomic.h> is still
+    an experimental switch. atomic_add_i64 returns the new value, atomic_exchange_i64 the old one.
+ */
+typedef volatile int64_t atomic_i64_t;
+
+#ifdef _WIN32
+    #define THREAD_LOCAL __declspec(thread)
+
+    static inline int64_t atomic_load_i64(atomic_i64_t *p)              { return InterlockedOr64(p, 0); }
+    static inline void atomic_store_i64(atomic_i64_t *p, int64_t value) { InterlockedExchange64(p, value); }
+    static inline int64_t atomic_add_i64(atomic_i64_t *p, int64_t value){ return InterlockedAdd64(p, value); }
+    static inline int64_t atomic_exchange_i64(atomic_i64_t *p, int64_t value) { return InterlockedExchange64(p, value); }
+    static inline void atomic_fence(void)                               { MemoryBarrier(); }
+
+    static inline bool atomic_cas_i64(atomic_i64_t *p, int64_t expected, int64_t desired)
+    {
+        return InterlockedCompareExchange64(p, desired, expected) == expected;
+    }
+#else
+    #define THREAD_LOCAL _Thread_local
+
+    static inline int64_t atomic_load_i64(atomic_i64_t *p)              { return __atomic_load_n(p, __ATOMIC_SEQ_CST); }
+    static inline void atomic_store_i64(atomic_i64_t *p, int64_t value) { __atomic_store_n(p, value, __ATOMIC_SEQ_CST); }
+    static inline int64_t atomic_add_i64(atomic_i64_t *p, int64_t value){ return __atomic_add_fetch(p, value, __ATOMIC_SEQ_CST); }
+    static inline int64_t atomic_exchange_i64(atomic_i64_t *p, int64_t value) { return __atomic_exchange_n(p, value, __ATOMIC_SEQ_CST); }
+    static inline void atomic_fence(void)                               { __atomic_thread_fence(__ATOMIC_SEQ_CST); }
+
+    static inline bool atomic_cas_i64(atomic_i64_t *p, int64_t expected, int64_t desired)
+    {
+        return __atomic_compare_exchange_n(p, &expected, desired, false, __ATOMIC_SEQ_CST, __ATOMIC_SEQ_CST);
+    }
+#endif
+
 int get_core_count(void);
+cpu_features_t get_cpu_features(void);
 
 #endif
\ No newline at end of file